@@ -6,7 +6,24 @@ All Rights Reserved
 */
 
 #include <stdlib.h>
+#include <pthread.h>
 #include "avl.h"
+#include "mem.h"
+
+// largest number of freed nodes each thread keeps for reuse
+#define POOL 4096
+
+// number of nodes allocated by each thread, kept per thread so counting costs no synchronization
+_Thread_local unsigned long AVL_allocations = 0;
+
+// freed nodes kept by each thread for reuse, linked through their parent pointers
+_Thread_local AVL_Node *AVL_pool = NULL;
+_Thread_local unsigned long AVL_pooled = 0;
+
+// key whose destructor frees the pool of a thread as it exits, set by each thread once it pools a node
+pthread_key_t AVL_poolkey;
+pthread_once_t AVL_poolonce = PTHREAD_ONCE_INIT;
+_Thread_local int AVL_registered = 0;
 
 AVL_Tree *AVL_Initialize(AVL_Tree *tree, AVL_Destroyer kfree, AVL_Destroyer vfree, AVL_Comparator comparator)
 {
@@ -18,21 +35,72 @@ AVL_Tree *AVL_Initialize(AVL_Tree *tree, AVL_Destroyer kfree, AVL_Destroyer vfre
 	return tree;
 }
 
-// helper function frees memory of node, its key and value, and its children recursively
+// helper function frees the pool of a thread as it exits
+// takes the value of the key, which is not used
+void AVL_ExitThread(void *value)
+{
+	(void)value;
+	AVL_ReleasePool();
+	// a destructor run after this one may pool nodes again, registering the thread again
+	AVL_registered = 0;
+}
+
+// helper function creates the key freeing pools of exiting threads
+void AVL_CreatePoolKey()
+{
+	pthread_key_create(&AVL_poolkey, AVL_ExitThread);
+}
+
+// helper function returns a node to the pool of the calling thread, or frees it if the pool is full
+// takes a pointer to the node
+void AVL_ReleaseNode(AVL_Node *node)
+{
+	if(AVL_pooled < POOL)
+	{
+		if(!AVL_registered)
+		{
+			pthread_once(&AVL_poolonce, AVL_CreatePoolKey);
+			pthread_setspecific(AVL_poolkey, &AVL_registered);
+			AVL_registered = 1;
+		}
+		node->parent = AVL_pool;
+		AVL_pool = node;
+		AVL_pooled++;
+	}
+	else MEM_RELEASE(MEM_AVL, node, sizeof(AVL_Node));
+}
+
+// helper function frees memory of node, its key and value, and its children
+// walks the subtree through parent pointers rather than recursing, so the depth of the subtree costs no stack
 // takes a pointer to the tree and the node to destroy
 void AVL_DestroyNode(AVL_Tree *tree, AVL_Node *node)
 {
 	if(!node) return;
-	AVL_DestroyNode(tree, node->left);
-	AVL_DestroyNode(tree, node->right);
-	if(tree->kfree) tree->kfree(node->key);
-	if(tree->vfree) tree->vfree(node->value);
-	free(node);
+	AVL_Node *stop = node->parent;
+	while(node != stop)
+	{
+		if(node->left) node = node->left;
+		else if(node->right) node = node->right;
+		else
+		{
+			AVL_Node *parent = node->parent;
+			if(parent != stop)
+			{
+				if(node == parent->left) parent->left = NULL;
+				else parent->right = NULL;
+			}
+			if(tree->kfree) tree->kfree(node->key);
+			if(tree->vfree) tree->vfree(node->value);
+			AVL_ReleaseNode(node);
+			node = parent;
+		}
+	}
 }
 
 void AVL_Clear(AVL_Tree *tree)
 {
 	AVL_DestroyNode(tree, tree->root);
+	tree->root = NULL;
 	tree->size = 0;
 }
 
@@ -58,12 +126,13 @@ POLY_Polymorphic AVL_Get(AVL_Tree *tree, POLY_Polymorphic key)
 	else return POLY_DEFAULT;
 }
 
-// helper function recalculates the height value for a node
+// helper function recalculates the height value and subtree size for a node
 // takes a pointer to the node to recalculate
 // returns the height
 int AVL_RecalcHeight(AVL_Node *node)
 {
 	if(!node) return 0;
+	node->count = 1 + (node->left ? node->left->count : 0) + (node->right ? node->right->count : 0);
 	if(node->right)
 	{
 		if(node->left)
@@ -158,39 +227,84 @@ void AVL_Repair(AVL_Tree *tree, AVL_Node *node)
 	}
 }
 
-void AVL_Set(AVL_Tree *tree, POLY_Polymorphic key, POLY_Polymorphic value)
+// helper function allocates a node with no children
+// takes the key and value of the node
+// returns a pointer to the node
+AVL_Node *AVL_CreateNode(POLY_Polymorphic key, POLY_Polymorphic value)
 {
-	int comparison;
-	AVL_Node *parent = tree->root;
-	AVL_Node *next;
-	AVL_Node *node;
-	if(parent)
+	AVL_Node *node = AVL_pool;
+	if(node)
 	{
-		while(parent)
-		{
-			if(comparison = tree->comparator(key, parent->key))
-			{
-				if(comparison > 0) next = parent->right;
-				else next = parent->left;
-				if(next) parent = next;
-				else break;
-			}
-			else
-			{
-				if(tree->vfree) tree->vfree(parent->value);
-				parent->value = value;
-				return;
-			}
-		}
+		AVL_pool = node->parent;
+		AVL_pooled--;
 	}
-	tree->size++;
-	node = malloc(sizeof(AVL_Node));
-	node->parent = parent;
+	else
+	{
+		node = MEM_ALLOCATE(MEM_AVL, sizeof(AVL_Node));
+		AVL_allocations++;
+	}
+	node->parent = NULL;
 	node->left = NULL;
 	node->right = NULL;
 	node->height = 1;
+	node->count = 1;
 	node->key = key;
 	node->value = value;
+	return node;
+}
+
+// helper function links nodes already in order into a perfectly balanced subtree
+// takes an array of pointers to the nodes, the number of nodes, and the parent of the subtree
+// returns the root of the subtree
+AVL_Node *AVL_Link(AVL_Node **nodes, unsigned long count, AVL_Node *parent)
+{
+	if(!count) return NULL;
+	unsigned long middle = count/2;
+	AVL_Node *node = nodes[middle];
+	node->parent = parent;
+	node->left = AVL_Link(nodes, middle, node);
+	node->right = AVL_Link(nodes + middle + 1, count - middle - 1, node);
+	AVL_RecalcHeight(node);
+	return node;
+}
+
+AVL_Tree *AVL_InitializeSorted(AVL_Tree *tree, AVL_Destroyer kfree, AVL_Destroyer vfree, AVL_Comparator comparator, POLY_Polymorphic *keys, POLY_Polymorphic *values, unsigned long count)
+{
+	AVL_Initialize(tree, kfree, vfree, comparator);
+	if(!count) return tree;
+	AVL_Node **nodes = malloc(sizeof(AVL_Node*)*count);
+	for(unsigned long i = 0; i < count; i++) nodes[i] = AVL_CreateNode(keys[i], values ? values[i] : POLY_DEFAULT);
+	tree->root = AVL_Link(nodes, count, NULL);
+	tree->size = count;
+	free(nodes);
+	return tree;
+}
+
+AVL_Tree *AVL_InitializeFromIterator(AVL_Tree *tree, AVL_Destroyer kfree, AVL_Destroyer vfree, AVL_Iterator *iterator, unsigned long count)
+{
+	AVL_Initialize(tree, kfree, vfree, iterator->tree->comparator);
+	if(!count) return tree;
+	AVL_Node **nodes = malloc(sizeof(AVL_Node*)*count);
+	unsigned long taken = 0;
+	while(taken < count && AVL_Next(iterator)) nodes[taken++] = AVL_CreateNode(AVL_Key(iterator), AVL_Value(iterator));
+	tree->root = AVL_Link(nodes, taken, NULL);
+	tree->size = taken;
+	free(nodes);
+	return tree;
+}
+
+AVL_Tree *AVL_Copy(AVL_Tree *tree, AVL_Tree *source, AVL_Destroyer kfree, AVL_Destroyer vfree)
+{
+	AVL_Iterator iterator;
+	AVL_InitializeIterator(source, &iterator);
+	return AVL_InitializeFromIterator(tree, kfree, vfree, &iterator, source->size);
+}
+
+void AVL_Attach(AVL_Tree *tree, AVL_Node *parent, int comparison, POLY_Polymorphic key, POLY_Polymorphic value)
+{
+	tree->size++;
+	AVL_Node *node = AVL_CreateNode(key, value);
+	node->parent = parent;
 	if(parent)
 	{
 		if(comparison > 0)
@@ -210,6 +324,33 @@ void AVL_Set(AVL_Tree *tree, POLY_Polymorphic key, POLY_Polymorphic value)
 	}
 }
 
+void AVL_Set(AVL_Tree *tree, POLY_Polymorphic key, POLY_Polymorphic value)
+{
+	int comparison = 0;
+	AVL_Node *parent = tree->root;
+	AVL_Node *next;
+	if(parent)
+	{
+		while(parent)
+		{
+			if(comparison = tree->comparator(key, parent->key))
+			{
+				if(comparison > 0) next = parent->right;
+				else next = parent->left;
+				if(next) parent = next;
+				else break;
+			}
+			else
+			{
+				if(tree->vfree) tree->vfree(parent->value);
+				parent->value = value;
+				return;
+			}
+		}
+	}
+	AVL_Attach(tree, parent, comparison, key, value);
+}
+
 void AVL_Insert(AVL_Tree *tree, POLY_Polymorphic key)
 {
 	AVL_Set(tree, key, POLY_DEFAULT);
@@ -218,9 +359,13 @@ void AVL_Insert(AVL_Tree *tree, POLY_Polymorphic key)
 void AVL_Delete(AVL_Tree *tree, POLY_Polymorphic key)
 {
 	AVL_Node *container = AVL_GetNode(tree, key);
+	if(container) AVL_Remove(tree, container);
+}
+
+void AVL_Remove(AVL_Tree *tree, AVL_Node *container)
+{
 	AVL_Node *delete;
 	AVL_Node *parent;
-	if(!container) return;
 	tree->size--;
 	if(container->right)
 	{
@@ -239,8 +384,7 @@ void AVL_Delete(AVL_Tree *tree, POLY_Polymorphic key)
 				parent->left = delete->left;
 				if(delete->left) delete->left->parent = parent;
 			}
-			if(tree->kfree) tree->kfree(container->key);
-			if(tree->vfree) tree->vfree(container->value);
+			// the key and value being deleted move to the node being freed, which destroys them
 			POLY_Polymorphic tmp;
 			tmp = delete->key;
 			delete->key = container->key;
@@ -360,6 +504,87 @@ int AVL_Next(AVL_Iterator *iterator)
 	else return 0;
 }
 
+// helper function finds the node at a position in order
+// takes a pointer to the tree and the position, counting from 0
+// returns a pointer to the node or NULL if the position is past the end
+AVL_Node *AVL_SelectNode(AVL_Tree *tree, unsigned long index)
+{
+	AVL_Node *current = tree->root;
+	while(current)
+	{
+		unsigned long left = current->left ? current->left->count : 0;
+		if(index < left) current = current->left;
+		else if(index > left)
+		{
+			index -= left + 1;
+			current = current->right;
+		}
+		else break;
+	}
+	return current;
+}
+
+// helper function finds the first node whose key is not less than, or with upper set greater than, a key
+// takes a pointer to the tree, the key, and whether to find the upper bound
+// returns a pointer to the node or NULL if there is none
+AVL_Node *AVL_BoundNode(AVL_Tree *tree, POLY_Polymorphic key, int upper)
+{
+	AVL_Node *current = tree->root;
+	AVL_Node *bound = NULL;
+	while(current)
+	{
+		int comparison = tree->comparator(key, current->key);
+		if(comparison < 0 || (!comparison && !upper))
+		{
+			bound = current;
+			current = current->left;
+		}
+		else current = current->right;
+	}
+	return bound;
+}
+
+POLY_Polymorphic AVL_Select(AVL_Tree *tree, unsigned long index)
+{
+	AVL_Node *node = AVL_SelectNode(tree, index);
+	if(node) return node->key;
+	else return POLY_DEFAULT;
+}
+
+unsigned long AVL_Rank(AVL_Tree *tree, POLY_Polymorphic key)
+{
+	unsigned long rank = 0;
+	AVL_Node *current = tree->root;
+	while(current)
+	{
+		if(tree->comparator(key, current->key) > 0)
+		{
+			rank += 1 + (current->left ? current->left->count : 0);
+			current = current->right;
+		}
+		else current = current->left;
+	}
+	return rank;
+}
+
+int AVL_Seek(AVL_Iterator *iterator, unsigned long index)
+{
+	iterator->current = AVL_SelectNode(iterator->tree, index);
+	return iterator->current != NULL;
+}
+
+int AVL_SeekLowerBound(AVL_Iterator *iterator, POLY_Polymorphic key)
+{
+	iterator->current = AVL_BoundNode(iterator->tree, key, 0);
+	return iterator->current != NULL;
+}
+
+int AVL_SeekUpperBound(AVL_Iterator *iterator, POLY_Polymorphic key)
+{
+	iterator->current = AVL_BoundNode(iterator->tree, key, 1);
+	return iterator->current != NULL;
+}
+
 POLY_Polymorphic AVL_Key(AVL_Iterator *iterator)
 {
 	if(iterator->current) return iterator->current->key;
@@ -377,6 +602,140 @@ void AVL_Reset(AVL_Iterator *iterator)
 	iterator->current = NULL;
 }
 
+// helper function lists the nodes of a tree in order
+// takes a pointer to the tree
+// returns an array of pointers to the nodes, which the caller frees
+AVL_Node **AVL_Flatten(AVL_Tree *tree)
+{
+	AVL_Node **nodes = malloc(sizeof(AVL_Node*)*(tree->size ? tree->size : 1));
+	AVL_Iterator iterator;
+	AVL_InitializeIterator(tree, &iterator);
+	for(unsigned long i = 0; AVL_Next(&iterator); i++) nodes[i] = iterator.current;
+	return nodes;
+}
+
+// helper function decides whether looking keys up one at a time is cheaper than merging
+// takes the number of lookups and the size of the tree they are made in
+// returns 1 if lookups are cheaper, 0 otherwise
+int AVL_PreferLookups(unsigned long lookups, unsigned long size)
+{
+	unsigned long depth = 1;
+	while(size >>= 1) depth++;
+	return lookups*depth < lookups + size;
+}
+
+// helper function keeps or destroys each node of a tree according to whether its key is in another tree
+// takes a pointer to the tree, a pointer to the other tree, and whether to keep the nodes whose keys are in the other tree
+void AVL_Filter(AVL_Tree *tree, AVL_Tree *other, int keep)
+{
+	unsigned long size = tree->size;
+	if(!size) return;
+	AVL_Node **nodes = AVL_Flatten(tree);
+	unsigned long kept = 0;
+	AVL_Iterator iterator;
+	AVL_InitializeIterator(other, &iterator);
+	int more = AVL_Next(&iterator);
+	int lookups = AVL_PreferLookups(size, other->size);
+	for(unsigned long i = 0; i < size; i++)
+	{
+		int contained;
+		if(lookups) contained = AVL_Contains(other, nodes[i]->key);
+		else
+		{
+			int comparison = 1;
+			while(more && (comparison = tree->comparator(nodes[i]->key, AVL_Key(&iterator))) > 0) more = AVL_Next(&iterator);
+			contained = more && !comparison;
+		}
+		if(contained == keep) nodes[kept++] = nodes[i];
+		else
+		{
+			nodes[i]->left = NULL;
+			nodes[i]->right = NULL;
+			AVL_DestroyNode(tree, nodes[i]);
+		}
+	}
+	tree->root = AVL_Link(nodes, kept, NULL);
+	tree->size = kept;
+	free(nodes);
+}
+
+void AVL_Union(AVL_Tree *tree, AVL_Tree *other)
+{
+	AVL_Iterator iterator;
+	AVL_InitializeIterator(other, &iterator);
+	if(AVL_PreferLookups(other->size, tree->size))
+	{
+		while(AVL_Next(&iterator))
+			if(!AVL_GetNode(tree, AVL_Key(&iterator))) AVL_Set(tree, AVL_Key(&iterator), AVL_Value(&iterator));
+		return;
+	}
+	unsigned long size = tree->size;
+	AVL_Node **nodes = AVL_Flatten(tree);
+	AVL_Node **merged = malloc(sizeof(AVL_Node*)*(size + other->size));
+	unsigned long count = 0;
+	unsigned long i = 0;
+	while(AVL_Next(&iterator))
+	{
+		int comparison = 1;
+		while(i < size && (comparison = tree->comparator(nodes[i]->key, AVL_Key(&iterator))) < 0) merged[count++] = nodes[i++];
+		if(i < size && !comparison) merged[count++] = nodes[i++];
+		else merged[count++] = AVL_CreateNode(AVL_Key(&iterator), AVL_Value(&iterator));
+	}
+	while(i < size) merged[count++] = nodes[i++];
+	tree->root = AVL_Link(merged, count, NULL);
+	tree->size = count;
+	free(nodes);
+	free(merged);
+}
+
+void AVL_Intersection(AVL_Tree *tree, AVL_Tree *other)
+{
+	AVL_Filter(tree, other, 1);
+}
+
+void AVL_Difference(AVL_Tree *tree, AVL_Tree *other)
+{
+	AVL_Filter(tree, other, 0);
+}
+
+int AVL_IsSubset(AVL_Tree *tree, AVL_Tree *other)
+{
+	if(tree->size > other->size) return 0;
+	AVL_Iterator outer;
+	AVL_InitializeIterator(tree, &outer);
+	if(AVL_PreferLookups(tree->size, other->size))
+	{
+		while(AVL_Next(&outer))
+			if(!AVL_GetNode(other, AVL_Key(&outer))) return 0;
+		return 1;
+	}
+	AVL_Iterator inner;
+	AVL_InitializeIterator(other, &inner);
+	while(AVL_Next(&outer))
+	{
+		int comparison = 1;
+		while(AVL_Next(&inner) && (comparison = tree->comparator(AVL_Key(&outer), AVL_Key(&inner))) > 0);
+		if(comparison) return 0;
+	}
+	return 1;
+}
+
+unsigned long AVL_Allocations()
+{
+	return AVL_allocations;
+}
+
+void AVL_ReleasePool()
+{
+	while(AVL_pool)
+	{
+		AVL_Node *next = AVL_pool->parent;
+		MEM_RELEASE(MEM_AVL, AVL_pool, sizeof(AVL_Node));
+		AVL_pool = next;
+	}
+	AVL_pooled = 0;
+}
+
 int AVL_DeepComparator(POLY_Polymorphic key1, POLY_Polymorphic key2)
 {
 	if (AVL_POLYTREE(key1)->size < AVL_POLYTREE(key2)->size) return -1;
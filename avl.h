@@ -30,12 +30,14 @@ typedef int (*AVL_Comparator)(POLY_Polymorphic key1, POLY_Polymorphic key2);
 typedef void (*AVL_Destroyer)(POLY_Polymorphic item);
 
 // represents a node in an AVL tree
+// count is the number of nodes in the subtree rooted at the node, used for order statistics
 typedef struct AVL_Node
 {
 	struct AVL_Node *parent;
 	struct AVL_Node *left;
 	struct AVL_Node *right;
 	int height;
+	unsigned long count;
 	POLY_Polymorphic key;
 	POLY_Polymorphic value;
 } AVL_Node;
@@ -63,6 +65,26 @@ typedef struct AVL_Iterator
 // returns a pointer to the tree
 AVL_Tree *AVL_Initialize(AVL_Tree *tree, AVL_Destroyer kfree, AVL_Destroyer vfree, AVL_Comparator comparator);
 
+// initialize a tree holding keys and values that are already sorted, building it balanced in linear time
+// takes a pointer to the memory to initialize, the functions used to destroy keys, destroy values, and compare keys,
+// arrays of keys in increasing order with no duplicates and of the values associated with them, and the number of keys
+// values may be NULL to insert keys with no associated value
+// returns a pointer to the tree
+AVL_Tree *AVL_InitializeSorted(AVL_Tree *tree, AVL_Destroyer kfree, AVL_Destroyer vfree, AVL_Comparator comparator, POLY_Polymorphic *keys, POLY_Polymorphic *values, unsigned long count);
+
+// initialize a tree holding the remaining keys and values of an iterator, building it balanced in linear time
+// takes a pointer to the memory to initialize, the functions used to destroy keys and values, a pointer to the iterator,
+// and the number of keys to take from it, the comparator is that of the iterator's tree
+// the keys and values are shared with the iterator's tree, not duplicated, so at most one of the trees should destroy them
+// returns a pointer to the tree
+AVL_Tree *AVL_InitializeFromIterator(AVL_Tree *tree, AVL_Destroyer kfree, AVL_Destroyer vfree, AVL_Iterator *iterator, unsigned long count);
+
+// initialize a tree as a copy of another in linear time
+// takes a pointer to the memory to initialize, a pointer to the tree to copy, and the functions used to destroy keys and values
+// the keys and values are shared with the copied tree, not duplicated, so at most one of the trees should destroy them
+// returns a pointer to the tree
+AVL_Tree *AVL_Copy(AVL_Tree *tree, AVL_Tree *source, AVL_Destroyer kfree, AVL_Destroyer vfree);
+
 // remove all items from a tree and free associate memory
 // takes a pointer to the tree
 void AVL_Clear(AVL_Tree *tree);
@@ -105,6 +127,31 @@ AVL_Iterator* AVL_InitializeIterator(AVL_Tree *tree, AVL_Iterator *iterator);
 // returns 0 if the end has been reached, 1 otherwise
 int AVL_Next(AVL_Iterator *iterator);
 
+// gets the key at a position in the order of a tree
+// takes a pointer to the tree and the position, counting from 0
+// returns the key or POLY_DEFAULT if the position is past the end
+POLY_Polymorphic AVL_Select(AVL_Tree *tree, unsigned long index);
+
+// finds the position a key has or would have in the order of a tree
+// takes a pointer to the tree and the key
+// returns the number of keys in the tree less than the key
+unsigned long AVL_Rank(AVL_Tree *tree, POLY_Polymorphic key);
+
+// moves an iterator to a position in the order of its tree, so iteration continues from there
+// takes a pointer to the iterator and the position, counting from 0
+// returns 0 and resets the iterator if the position is past the end, 1 otherwise
+int AVL_Seek(AVL_Iterator *iterator, unsigned long index);
+
+// moves an iterator to the first key not less than a key, so iteration continues from there
+// takes a pointer to the iterator and the key
+// returns 0 and resets the iterator if there is no such key, 1 otherwise
+int AVL_SeekLowerBound(AVL_Iterator *iterator, POLY_Polymorphic key);
+
+// moves an iterator to the first key greater than a key, so iteration continues from there
+// takes a pointer to the iterator and the key
+// returns 0 and resets the iterator if there is no such key, 1 otherwise
+int AVL_SeekUpperBound(AVL_Iterator *iterator, POLY_Polymorphic key);
+
 // gets the key of the current element of an iterator
 // takes a pointer to the iterator
 // returns the key
@@ -119,6 +166,50 @@ POLY_Polymorphic AVL_Value(AVL_Iterator *iterator);
 // takes a pointer to the iterator
 void AVL_Reset(AVL_Iterator *iterator);
 
+// counts the nodes allocated by the calling thread
+// nodes reused from the pool of the thread are not counted
+// returns the number of nodes the calling thread has allocated since it started
+unsigned long AVL_Allocations();
+
+// frees the nodes the calling thread keeps for reuse after destroying them
+// a thread's pool is freed when it exits, so this need only be called to give the memory back sooner, or by the main
+// thread, whose pool is not freed when it returns from main
+void AVL_ReleasePool();
+
+// adds the keys of another tree to a tree, in linear time by merging unless the other tree is much smaller
+// keys already in the tree keep their values, other keys are added with their values from the other tree
+// takes a pointer to the tree to modify and a pointer to the other tree, whose comparator must agree
+// the keys and values added are shared with the other tree, not duplicated, so at most one of the trees should destroy them
+// to compute a union without modifying either tree, apply this to an AVL_Copy
+void AVL_Union(AVL_Tree *tree, AVL_Tree *other);
+
+// removes the keys of a tree that are not in another tree, destroying them and their values
+// takes a pointer to the tree to modify and a pointer to the other tree, whose comparator must agree
+void AVL_Intersection(AVL_Tree *tree, AVL_Tree *other);
+
+// removes the keys of a tree that are also in another tree, destroying them and their values
+// takes a pointer to the tree to modify and a pointer to the other tree, whose comparator must agree
+void AVL_Difference(AVL_Tree *tree, AVL_Tree *other);
+
+// determines whether every key of a tree is also in another tree
+// takes pointers to the tree and the other tree, whose comparator must agree
+// returns 1 if the tree is a subset of the other, returns 0 otherwise
+int AVL_IsSubset(AVL_Tree *tree, AVL_Tree *other);
+
+// allocates a node with no children, for specialized operations, see avlgen.h
+// takes the key and value of the node
+// returns a pointer to the node
+AVL_Node *AVL_CreateNode(POLY_Polymorphic key, POLY_Polymorphic value);
+
+// adds a key known not to be in a tree below the node where a search for it ended, for specialized operations
+// takes a pointer to the tree, the node where the search ended or NULL if the tree is empty,
+// the comparison of the key with the key of that node, and the key and value
+void AVL_Attach(AVL_Tree *tree, AVL_Node *parent, int comparison, POLY_Polymorphic key, POLY_Polymorphic value);
+
+// removes a node from a tree, destroying its key and value, for specialized operations
+// takes a pointer to the tree and the node
+void AVL_Remove(AVL_Tree *tree, AVL_Node *node);
+
 // a function to do a deep comparison of two trees, note values are ignored, only keys are considered
 // the key comparator for the first tree will be used to compare keys between the trees
 // takes pointers to the two trees to compare
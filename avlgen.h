@@ -0,0 +1,100 @@
+/*
+Header file for AVL tree operations specialized to a key type
+
+Copyright (C) 2016 Kyle Gagner
+All Rights Reserved
+*/
+
+// for tree types and helpers
+#include "avl.h"
+
+// include guard
+#ifndef AVLGEN_H
+#define AVLGEN_H
+
+// compares two values of a type with < and >, for building comparisons
+// returns zero if value1 == value2, negative value if value1 < value2, and positive if value1 > value2
+#define AVL_COMPARE_VALUES(value1, value2) (((value1) > (value2)) - ((value1) < (value2)))
+
+// comparisons of keys stored as uint16s, uint32s, uint64s or references
+#define AVL_COMPARE_UINT16(key1, key2) AVL_COMPARE_VALUES((key1).uint16, (key2).uint16)
+#define AVL_COMPARE_UINT32(key1, key2) AVL_COMPARE_VALUES((key1).uint32, (key2).uint32)
+#define AVL_COMPARE_UINT64(key1, key2) AVL_COMPARE_VALUES((key1).uint64, (key2).uint64)
+#define AVL_COMPARE_REF(key1, key2) AVL_COMPARE_VALUES((char*)(key1).ref, (char*)(key2).ref)
+
+// defines operations on AVL trees whose comparison of keys is inlined rather than called through the comparator,
+// named by appending Get, Set, Insert, Delete, Contains and DeepComparator to the name
+// the operations work on any AVL_Tree whose comparator agrees with the comparison, and may be mixed with the generic ones
+// takes the name and a comparison of keys, a function-like macro or function taking two keys, returning as a comparator does
+#define AVL_SPECIALIZE(name, compare) \
+\
+static inline AVL_Node *name##GetNode(AVL_Tree *tree, POLY_Polymorphic key) \
+{ \
+	AVL_Node *current = tree->root; \
+	while(current) \
+	{ \
+		int comparison = compare(key, current->key); \
+		if(!comparison) break; \
+		current = comparison > 0 ? current->right : current->left; \
+	} \
+	return current; \
+} \
+\
+static inline POLY_Polymorphic name##Get(AVL_Tree *tree, POLY_Polymorphic key) \
+{ \
+	AVL_Node *node = name##GetNode(tree, key); \
+	return node ? node->value : POLY_DEFAULT; \
+} \
+\
+static inline int name##Contains(AVL_Tree *tree, POLY_Polymorphic key) \
+{ \
+	return name##GetNode(tree, key) ? 1 : 0; \
+} \
+\
+static inline void name##Set(AVL_Tree *tree, POLY_Polymorphic key, POLY_Polymorphic value) \
+{ \
+	AVL_Node *parent = tree->root; \
+	int comparison = 0; \
+	while(parent) \
+	{ \
+		comparison = compare(key, parent->key); \
+		if(!comparison) \
+		{ \
+			if(tree->vfree) tree->vfree(parent->value); \
+			parent->value = value; \
+			return; \
+		} \
+		AVL_Node *next = comparison > 0 ? parent->right : parent->left; \
+		if(!next) break; \
+		parent = next; \
+	} \
+	AVL_Attach(tree, parent, comparison, key, value); \
+} \
+\
+static inline void name##Insert(AVL_Tree *tree, POLY_Polymorphic key) \
+{ \
+	name##Set(tree, key, POLY_DEFAULT); \
+} \
+\
+static inline void name##Delete(AVL_Tree *tree, POLY_Polymorphic key) \
+{ \
+	AVL_Node *node = name##GetNode(tree, key); \
+	if(node) AVL_Remove(tree, node); \
+} \
+\
+static inline int name##DeepComparator(POLY_Polymorphic key1, POLY_Polymorphic key2) \
+{ \
+	AVL_Tree *tree1 = AVL_POLYTREE(key1); \
+	AVL_Tree *tree2 = AVL_POLYTREE(key2); \
+	if(tree1->size != tree2->size) return tree1->size < tree2->size ? -1 : 1; \
+	AVL_Iterator iter1; \
+	AVL_InitializeIterator(tree1, &iter1); \
+	AVL_Iterator iter2; \
+	AVL_InitializeIterator(tree2, &iter2); \
+	int comparison = 0; \
+	while(AVL_Next(&iter1) && AVL_Next(&iter2)) \
+		if((comparison = compare(iter1.current->key, iter2.current->key))) break; \
+	return comparison; \
+}
+
+#endif
@@ -0,0 +1,274 @@
+/*
+Benchmark for regular expression compiler
+
+Copyright (C) 2016 Kyle Gagner
+All Rights Reserved
+
+Compiles generated workloads and prints one CSV line per workload with the time spent in each phase,
+the number of allocations made and the peak resident set size of the process so far
+allocations are only counted with glibc and without a sanitizer, which replaces the allocator, and are left empty otherwise
+built with MEM_ACCOUNTING, it also prints the accounted bytes still live after the machine is destroyed, left empty otherwise
+usage: bench_compile [workload] [repetitions] [threads] [groups]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include "regex.h"
+#include "avl.h"
+#include "mem.h"
+
+// sanitizers replace the allocator themselves, so it cannot be wrapped under one
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+#define SANITIZED
+#endif
+#ifdef __has_feature
+#if __has_feature(address_sanitizer) || __has_feature(thread_sanitizer) || __has_feature(memory_sanitizer)
+#define SANITIZED
+#endif
+#endif
+
+// with glibc, allocations are counted by wrapping the allocator
+#if defined(__GLIBC__) && !defined(SANITIZED)
+#define COUNTED 1
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *pointer, size_t size);
+
+static unsigned long allocations;
+
+void *malloc(size_t size)
+{
+	__atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+	__atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+	return __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, size_t size)
+{
+	__atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+	return __libc_realloc(pointer, size);
+}
+
+#define ALLOCATIONS() __atomic_load_n(&allocations, __ATOMIC_RELAXED)
+#else
+#define COUNTED 0
+#define ALLOCATIONS() 0UL
+#endif
+
+// represents a growable buffer of expression text
+typedef struct
+{
+	char *text;
+	unsigned long length;
+	unsigned long capacity;
+} Buffer;
+
+// represents a named workload generator
+typedef struct
+{
+	const char *name;
+	unsigned long size;
+	void (*generate)(REGEX_Expressions *expressions, unsigned long size);
+} Workload;
+
+// appends text to a buffer
+void Append(Buffer *buffer, const char *text)
+{
+	unsigned long length = strlen(text);
+	if(buffer->length + length + 1 > buffer->capacity)
+	{
+		buffer->capacity = (buffer->length + length + 1)*2;
+		buffer->text = realloc(buffer->text, buffer->capacity);
+	}
+	memcpy(buffer->text + buffer->length, text, length + 1);
+	buffer->length += length;
+}
+
+// allocates the expressions of a workload
+void Allocate(REGEX_Expressions *expressions, unsigned long count)
+{
+	expressions->expressions_count = count;
+	expressions->expressions = calloc(count, sizeof(REGEX_Expression));
+}
+
+// widens text to a UTF-16 expression
+void SetExpression(REGEX_Expression *expression, const char *text, unsigned long accepts)
+{
+	unsigned long length = strlen(text);
+	expression->expression = malloc(sizeof(UNICODE_Char)*(length + 1));
+	for(unsigned long i = 0; i <= length; i++) expression->expression[i] = (unsigned char)text[i];
+	expression->accepts = accepts;
+	expression->flags = 0;
+}
+
+// writes a reproducible pseudorandom lowercase keyword
+// takes a pointer to the generator state and the buffer of at least 12 characters
+void Keyword(unsigned long *seed, char *keyword)
+{
+	*seed = *seed*6364136223846793005UL + 1442695040888963407UL;
+	int length = 3 + (*seed >> 33) % 8;
+	for(int i = 0; i < length; i++)
+	{
+		*seed = *seed*6364136223846793005UL + 1442695040888963407UL;
+		keyword[i] = 'a' + (*seed >> 33) % 26;
+	}
+	keyword[length] = 0;
+}
+
+// many separate keyword expressions plus an identifier expression, as in a lexer
+void GenerateKeywords(REGEX_Expressions *expressions, unsigned long size)
+{
+	char keyword[12];
+	unsigned long seed = size;
+	Allocate(expressions, size + 1);
+	SetExpression(&expressions->expressions[0], "(a|b|c|d|e|f|g|h|i|j|k|l|m|n|o|p|q|r|s|t|u|v|w|x|y|z)+", 1);
+	for(unsigned long n = 1; n <= size; n++)
+	{
+		Keyword(&seed, keyword);
+		SetExpression(&expressions->expressions[n], keyword, n + 1);
+	}
+}
+
+// the keywords workload with every expression case insensitive, which should need no more states than the keywords workload
+void GenerateKeywordsNoCase(REGEX_Expressions *expressions, unsigned long size)
+{
+	GenerateKeywords(expressions, size);
+	for(unsigned long n = 0; n < expressions->expressions_count; n++) expressions->expressions[n].flags = REGEX_CASE_INSENSITIVE;
+}
+
+// a single expression alternating between many keywords
+void GenerateAlternation(REGEX_Expressions *expressions, unsigned long size)
+{
+	char keyword[12];
+	unsigned long seed = size;
+	Buffer buffer = {NULL, 0, 0};
+	Append(&buffer, "(");
+	for(unsigned long n = 0; n < size; n++)
+	{
+		Keyword(&seed, keyword);
+		if(n) Append(&buffer, "|");
+		Append(&buffer, keyword);
+	}
+	Append(&buffer, ")");
+	Allocate(expressions, 1);
+	SetExpression(&expressions->expressions[0], buffer.text, 1);
+	free(buffer.text);
+}
+
+// stars nested size deep, such as ((a*b)*c)*
+void GenerateNestedStars(REGEX_Expressions *expressions, unsigned long size)
+{
+	Buffer buffer = {NULL, 0, 0};
+	for(unsigned long n = 0; n < size; n++) Append(&buffer, "(");
+	Append(&buffer, "a*");
+	for(unsigned long n = 0; n < size; n++)
+	{
+		char symbol[4] = {'b' + n % 25, ')', '*', 0};
+		Append(&buffer, symbol);
+	}
+	Allocate(expressions, 1);
+	SetExpression(&expressions->expressions[0], buffer.text, 1);
+	free(buffer.text);
+}
+
+// (a|b)*a(a|b){n}, whose minimal DFA has 2^(n+1) states
+void GenerateBlowup(REGEX_Expressions *expressions, unsigned long size)
+{
+	Buffer buffer = {NULL, 0, 0};
+	Append(&buffer, "(a|b)*a");
+	for(unsigned long n = 0; n < size; n++) Append(&buffer, "(a|b)");
+	Allocate(expressions, 1);
+	SetExpression(&expressions->expressions[0], buffer.text, 1);
+	free(buffer.text);
+}
+
+// frees the expressions of a workload
+void Release(REGEX_Expressions *expressions)
+{
+	for(unsigned long n = 0; n < expressions->expressions_count; n++) free(expressions->expressions[n].expression);
+	free(expressions->expressions);
+}
+
+// finds the peak resident set size of the process
+// returns the size in kilobytes
+long PeakResidentSize()
+{
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+int main(int argc, char **argv)
+{
+	Workload workloads[] =
+	{
+		{"keywords", 100, GenerateKeywords},
+		{"keywords", 1000, GenerateKeywords},
+		{"keywords_nocase", 100, GenerateKeywordsNoCase},
+		{"keywords_nocase", 1000, GenerateKeywordsNoCase},
+		{"alternation", 100, GenerateAlternation},
+		{"alternation", 1000, GenerateAlternation},
+		{"nested_stars", 8, GenerateNestedStars},
+		{"nested_stars", 32, GenerateNestedStars},
+		{"blowup", 6, GenerateBlowup},
+		{"blowup", 10, GenerateBlowup}
+	};
+	const char *filter = argc > 1 ? argv[1] : NULL;
+	int repetitions = argc > 2 ? atoi(argv[2]) : 3;
+	REGEX_Options options;
+	options.threads = argc > 3 ? atoi(argv[3]) : 0;
+	options.groups = argc > 4 ? atoi(argv[4]) : 0;
+	if(repetitions < 1) repetitions = 1;
+	printf("workload,size,threads,groups,states,nfa_states,nfa_epsilons,dfa_states,refinement_rounds,subset_largest,avl_allocations,construct_ms,convert_ms,simplify_ms,union_ms,export_ms,total_ms,allocations,peak_rss_kb,retained_bytes\n");
+	for(unsigned long w = 0; w < sizeof(workloads)/sizeof(Workload); w++)
+	{
+		if(filter && strcmp(filter, "all") && strcmp(filter, workloads[w].name)) continue;
+		REGEX_Expressions expressions;
+		workloads[w].generate(&expressions, workloads[w].size);
+		REGEX_Stats best = {0};
+		double besttotal = -1;
+		unsigned long states = 0;
+		unsigned long count = 0;
+		long retained = 0;
+		for(int r = 0; r < repetitions; r++)
+		{
+			REGEX_Stats stats;
+			options.stats = &stats;
+			MEM_Snapshot live;
+			unsigned long before = ALLOCATIONS();
+			unsigned long accounted = MEM_Live(MEM_TakeSnapshot(&live));
+			REGEX_Machine *machine = REGEX_CreateMachineWithOptions(&expressions, &options);
+			unsigned long made = ALLOCATIONS() - before;
+			states = machine->states_count;
+			REGEX_DestroyMachine(machine);
+			// pooled AVL nodes are not retained by the machine
+			AVL_ReleasePool();
+			retained = MEM_Live(MEM_TakeSnapshot(&live)) - accounted;
+			double total = stats.construct_seconds + stats.convert_seconds + stats.simplify_seconds + stats.union_seconds + stats.export_seconds;
+			if(besttotal < 0 || total < besttotal)
+			{
+				besttotal = total;
+				best = stats;
+				count = made;
+			}
+		}
+		printf("%s,%lu,%u,%u,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,", workloads[w].name, workloads[w].size, options.threads, options.groups, states,
+			best.nfa_states, best.nfa_epsilons, best.dfa_states + best.union_states, best.refinement_rounds, best.subset_largest, best.avl_allocations,
+			best.construct_seconds*1e3, best.convert_seconds*1e3, best.simplify_seconds*1e3, best.union_seconds*1e3, best.export_seconds*1e3, besttotal*1e3);
+		if(COUNTED) printf("%lu", count);
+		printf(",%ld,", PeakResidentSize());
+		if(MEM_Accounting()) printf("%ld\n", retained);
+		else printf("\n");
+		fflush(stdout);
+		Release(&expressions);
+	}
+	return 0;
+}
@@ -0,0 +1,389 @@
+/*
+Benchmark for container implementations
+
+Copyright (C) 2016 Kyle Gagner
+All Rights Reserved
+
+Measures the throughput and memory of each set and sequence container, printing one CSV line per container, key order and size
+with the time per operation of insertion, lookup, iteration, deletion and clearing, and the bytes allocated per element
+sets are filled with keys in random, sorted, reverse and zigzag order, the last alternating between the smallest and largest keys left,
+lookups are in random order and half of them miss, and keys are deleted in the order they were inserted
+sequences are filled at the tail and emptied from the head (fifo) or the tail (lifo)
+columns a container has no operation for are left empty, and memory is only measured where glibc reports allocations
+the keys depend only on the seed, so runs with the same seed are comparable
+usage: bench_containers [container] [largest size] [repetitions] [seed]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#include "avl.h"
+#include "avlgen.h"
+#include "cset.h"
+#include "btree.h"
+#include "hash.h"
+#include "cmap.h"
+#include "pavl.h"
+#include "list.h"
+#include "deque.h"
+#include "ulist.h"
+#include "queue.h"
+
+AVL_SPECIALIZE(UINT64_Tree, AVL_COMPARE_UINT64)
+
+// number of operations measured for each container
+#define OPERATIONS 5
+
+// names of the key orders sets are filled in
+const char *orders[] = {"random", "sorted", "reverse", "zigzag"};
+
+// represents a container to benchmark, through functions which adapt its interface
+// insert is also used to append to sequences, and delete to take from them, with the key ignored
+typedef struct
+{
+	const char *name;
+	int sequence;
+	void *(*create)(unsigned long size);
+	void (*insert)(void *container, POLY_Polymorphic key);
+	int (*contains)(void *container, POLY_Polymorphic key);
+	unsigned long (*iterate)(void *container);
+	void (*delete)(void *container, POLY_Polymorphic key);
+	void (*clear)(void *container);
+} Container;
+
+// an AVL comparator for uint64s
+static int Bench_UINT64Comparator(POLY_Polymorphic key1, POLY_Polymorphic key2)
+{
+	return AVL_COMPARE_UINT64(key1, key2);
+}
+
+// adapters for AVL trees, through the comparator and specialized to uint64 keys
+static void *Bench_AVLCreate(unsigned long size) { (void)size; return AVL_Initialize(malloc(sizeof(AVL_Tree)), NULL, NULL, Bench_UINT64Comparator); }
+static void Bench_AVLInsert(void *container, POLY_Polymorphic key) { AVL_Insert(container, key); }
+static int Bench_AVLContains(void *container, POLY_Polymorphic key) { return AVL_Contains(container, key); }
+static void Bench_AVLDelete(void *container, POLY_Polymorphic key) { AVL_Delete(container, key); }
+static void Bench_AVLClear(void *container) { AVL_Clear(container); free(container); }
+static unsigned long Bench_AVLIterate(void *container)
+{
+	unsigned long sum = 0;
+	AVL_Iterator iter;
+	AVL_InitializeIterator(container, &iter);
+	while(AVL_Next(&iter)) sum += AVL_Key(&iter).uint64;
+	return sum;
+}
+static void Bench_UINT64Insert(void *container, POLY_Polymorphic key) { UINT64_TreeInsert(container, key); }
+static int Bench_UINT64Contains(void *container, POLY_Polymorphic key) { return UINT64_TreeContains(container, key); }
+static void Bench_UINT64Delete(void *container, POLY_Polymorphic key) { UINT64_TreeDelete(container, key); }
+
+// adapters for compact sets
+static void *Bench_CSETCreate(unsigned long size) { (void)size; return CSET_Initialize(malloc(sizeof(CSET_Set)), NULL, Bench_UINT64Comparator); }
+static void Bench_CSETInsert(void *container, POLY_Polymorphic key) { CSET_Insert(container, key); }
+static int Bench_CSETContains(void *container, POLY_Polymorphic key) { return CSET_Contains(container, key); }
+static void Bench_CSETDelete(void *container, POLY_Polymorphic key) { CSET_Delete(container, key); }
+static void Bench_CSETClear(void *container) { CSET_Clear(container); free(container); }
+static unsigned long Bench_CSETIterate(void *container)
+{
+	unsigned long sum = 0;
+	CSET_Iterator iter;
+	CSET_InitializeIterator(container, &iter);
+	while(CSET_Next(&iter)) sum += CSET_Key(&iter).uint64;
+	return sum;
+}
+
+// adapters for B-trees
+static void *Bench_BTREECreate(unsigned long size) { (void)size; return BTREE_Initialize(malloc(sizeof(BTREE_Tree)), NULL, NULL, Bench_UINT64Comparator); }
+static void Bench_BTREEInsert(void *container, POLY_Polymorphic key) { BTREE_Insert(container, key); }
+static int Bench_BTREEContains(void *container, POLY_Polymorphic key) { return BTREE_Contains(container, key); }
+static void Bench_BTREEDelete(void *container, POLY_Polymorphic key) { BTREE_Delete(container, key); }
+static void Bench_BTREEClear(void *container) { BTREE_Clear(container); free(container); }
+static unsigned long Bench_BTREEIterate(void *container)
+{
+	unsigned long sum = 0;
+	BTREE_Iterator iter;
+	BTREE_InitializeIterator(container, &iter);
+	while(BTREE_Next(&iter)) sum += BTREE_Key(&iter).uint64;
+	return sum;
+}
+
+// adapters for hash tables
+static void *Bench_HASHCreate(unsigned long size) { (void)size; return HASH_Initialize(malloc(sizeof(HASH_Table)), NULL, NULL, HASH_UINT64Hasher, HASH_UINT64Equality); }
+static void Bench_HASHInsert(void *container, POLY_Polymorphic key) { HASH_Insert(container, key); }
+static int Bench_HASHContains(void *container, POLY_Polymorphic key) { return HASH_Contains(container, key); }
+static void Bench_HASHDelete(void *container, POLY_Polymorphic key) { HASH_Delete(container, key); }
+static void Bench_HASHClear(void *container) { HASH_Clear(container); free(container); }
+static unsigned long Bench_HASHIterate(void *container)
+{
+	unsigned long sum = 0;
+	HASH_Iterator iter;
+	HASH_InitializeIterator(container, &iter);
+	while(HASH_Next(&iter)) sum += HASH_Key(&iter).uint64;
+	return sum;
+}
+
+// represents a concurrent map with the reader used by the benchmark
+typedef struct
+{
+	CMAP_Map map;
+	CMAP_Reader reader;
+} ConcurrentMap;
+
+// adapters for concurrent maps, read through a registered reader
+static void *Bench_CMAPCreate(unsigned long size)
+{
+	(void)size;
+	ConcurrentMap *container = malloc(sizeof(ConcurrentMap));
+	CMAP_Initialize(&container->map, NULL, NULL, Bench_UINT64Comparator);
+	CMAP_Register(&container->map, &container->reader);
+	return container;
+}
+static void Bench_CMAPInsert(void *container, POLY_Polymorphic key) { CMAP_Insert(&((ConcurrentMap*)container)->map, key); }
+static int Bench_CMAPContains(void *container, POLY_Polymorphic key) { return CMAP_Contains(&((ConcurrentMap*)container)->reader, key); }
+static void Bench_CMAPDelete(void *container, POLY_Polymorphic key) { CMAP_Delete(&((ConcurrentMap*)container)->map, key); }
+static void Bench_CMAPClear(void *container)
+{
+	CMAP_Unregister(&((ConcurrentMap*)container)->reader);
+	CMAP_Destroy(POLY_REF(&((ConcurrentMap*)container)->map));
+}
+static unsigned long Bench_CMAPIterate(void *container)
+{
+	unsigned long sum = 0;
+	CMAP_Reader *reader = &((ConcurrentMap*)container)->reader;
+	CMAP_Iterator iter;
+	CMAP_Enter(reader);
+	CMAP_InitializeIterator(reader, &iter);
+	while(CMAP_Next(&iter)) sum += CMAP_Key(&iter).uint64;
+	CMAP_Leave(reader);
+	return sum;
+}
+
+// adapters for persistent trees, updated in place
+static void *Bench_PAVLCreate(unsigned long size) { (void)size; return PAVL_Initialize(malloc(sizeof(PAVL_Tree)), NULL, NULL, Bench_UINT64Comparator); }
+static void Bench_PAVLInsert(void *container, POLY_Polymorphic key) { PAVL_Insert(container, container, key); }
+static int Bench_PAVLContains(void *container, POLY_Polymorphic key) { return PAVL_Contains(container, key); }
+static void Bench_PAVLDelete(void *container, POLY_Polymorphic key) { PAVL_Delete(container, container, key); }
+static void Bench_PAVLClear(void *container) { PAVL_Destroy(POLY_REF(container)); }
+static unsigned long Bench_PAVLIterate(void *container)
+{
+	unsigned long sum = 0;
+	PAVL_Iterator iter;
+	PAVL_InitializeIterator(container, &iter);
+	while(PAVL_Next(&iter)) sum += PAVL_Key(&iter).uint64;
+	return sum;
+}
+
+// adapters for linked lists
+static void *Bench_LISTCreate(unsigned long size) { (void)size; return LIST_Initialize(malloc(sizeof(LIST_List))); }
+static void Bench_LISTAppend(void *container, POLY_Polymorphic key) { LIST_InsertTail(container, key); }
+static void Bench_LISTDequeue(void *container, POLY_Polymorphic key) { (void)key; LIST_TakeHead(container); }
+static void Bench_LISTPop(void *container, POLY_Polymorphic key) { (void)key; LIST_TakeTail(container); }
+static void Bench_LISTClear(void *container) { LIST_Clear(container); free(container); }
+static unsigned long Bench_LISTIterate(void *container)
+{
+	unsigned long sum = 0;
+	LIST_Iterator iter;
+	LIST_InitializeIterator(container, &iter);
+	while(LIST_Next(&iter)) sum += LIST_Peek(&iter).uint64;
+	return sum;
+}
+
+// adapters for deques
+static void *Bench_DEQUECreate(unsigned long size) { (void)size; return DEQUE_Initialize(malloc(sizeof(DEQUE_Deque))); }
+static void Bench_DEQUEAppend(void *container, POLY_Polymorphic key) { DEQUE_InsertTail(container, key); }
+static void Bench_DEQUEDequeue(void *container, POLY_Polymorphic key) { (void)key; DEQUE_TakeHead(container); }
+static void Bench_DEQUEPop(void *container, POLY_Polymorphic key) { (void)key; DEQUE_TakeTail(container); }
+static void Bench_DEQUEClear(void *container) { DEQUE_Clear(container); free(container); }
+static unsigned long Bench_DEQUEIterate(void *container)
+{
+	unsigned long sum = 0;
+	DEQUE_Iterator iter;
+	DEQUE_InitializeIterator(container, &iter);
+	while(DEQUE_Next(&iter)) sum += DEQUE_Peek(&iter).uint64;
+	return sum;
+}
+
+// adapters for unrolled lists
+static void *Bench_ULISTCreate(unsigned long size) { (void)size; return ULIST_Initialize(malloc(sizeof(ULIST_List))); }
+static void Bench_ULISTAppend(void *container, POLY_Polymorphic key) { ULIST_InsertTail(container, key); }
+static void Bench_ULISTDequeue(void *container, POLY_Polymorphic key) { (void)key; ULIST_TakeHead(container); }
+static void Bench_ULISTPop(void *container, POLY_Polymorphic key) { (void)key; ULIST_TakeTail(container); }
+static void Bench_ULISTClear(void *container) { ULIST_Clear(container); free(container); }
+static unsigned long Bench_ULISTIterate(void *container)
+{
+	unsigned long sum = 0;
+	ULIST_Iterator iter;
+	ULIST_InitializeIterator(container, &iter);
+	while(ULIST_Next(&iter)) sum += ULIST_Peek(&iter).uint64;
+	return sum;
+}
+
+// adapters for lock-free queues, used by a single thread and sized to hold every element
+static void *Bench_QUEUECreate(unsigned long size) { return QUEUE_Initialize(malloc(sizeof(QUEUE_Queue)), size); }
+static void Bench_QUEUEAppend(void *container, POLY_Polymorphic key) { QUEUE_InsertTail(container, key); }
+static void Bench_QUEUEDequeue(void *container, POLY_Polymorphic key) { (void)key; POLY_Polymorphic value; QUEUE_TryTakeHead(container, &value); }
+static void Bench_QUEUEClear(void *container) { QUEUE_Destroy(POLY_REF(container)); }
+
+// gets the time from a monotonic clock
+// returns the time in seconds
+double Now()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec*1e-9;
+}
+
+// finds the number of bytes currently allocated by malloc
+// returns the number of bytes, or 0 where it cannot be measured
+unsigned long Allocated()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+	// large blocks are mapped separately from the heap and counted apart
+	struct mallinfo2 info = mallinfo2();
+	return info.uordblks + info.hblkhd;
+#else
+	return 0;
+#endif
+}
+
+// advances a reproducible pseudorandom sequence
+// takes a pointer to the generator state
+// returns the next number
+unsigned long Random(unsigned long *seed)
+{
+	*seed = *seed*6364136223846793005UL + 1442695040888963407UL;
+	return *seed >> 17;
+}
+
+// generates the keys of a set in the order they are inserted, every key is even so that odd keys miss
+// takes the array to fill, the number of keys, the index of the order and the seed
+void Order(POLY_Polymorphic *keys, unsigned long size, int order, unsigned long seed)
+{
+	for(unsigned long n = 0; n < size; n++)
+	{
+		unsigned long value;
+		if(order == 1) value = n;
+		else if(order == 2) value = size - 1 - n;
+		else if(order == 3) value = n & 1 ? size - 1 - n/2 : n/2;
+		else value = n;
+		keys[n] = POLY_UINT64(2*value);
+	}
+	// random order is a shuffle of sorted order
+	if(order == 0)
+	{
+		for(unsigned long n = size - 1; n > 0; n--)
+		{
+			unsigned long m = Random(&seed) % (n + 1);
+			POLY_Polymorphic key = keys[n];
+			keys[n] = keys[m];
+			keys[m] = key;
+		}
+	}
+}
+
+// measures a container once at one size and key order
+// takes the container, the keys in order, the number of keys, the seed for lookups, and arrays for the times per operation and bytes per element
+void Measure(Container *type, POLY_Polymorphic *keys, unsigned long size, unsigned long seed, double *times, double *bytes)
+{
+	unsigned long checksum = 0;
+	AVL_ReleasePool();
+	unsigned long allocated = Allocated();
+	void *container = type->create(size);
+	double began = Now();
+	for(unsigned long n = 0; n < size; n++) type->insert(container, keys[n]);
+	times[0] = Now() - began;
+	*bytes = ((double)Allocated() - allocated)/size;
+	if(type->contains)
+	{
+		began = Now();
+		for(unsigned long n = 0; n < size; n++) checksum += type->contains(container, POLY_UINT64(Random(&seed) % (2*size)));
+		times[1] = Now() - began;
+	}
+	if(type->iterate)
+	{
+		began = Now();
+		checksum += type->iterate(container);
+		times[2] = Now() - began;
+	}
+	began = Now();
+	for(unsigned long n = 0; n < size; n++) type->delete(container, keys[n]);
+	times[3] = Now() - began;
+	for(unsigned long n = 0; n < size; n++) type->insert(container, keys[n]);
+	began = Now();
+	type->clear(container);
+	times[4] = Now() - began;
+	// keeps the lookups and iteration from being optimized away
+	if(checksum == 1) printf("unreachable\n");
+}
+
+// prints a line with the best time per operation of each operation the container has, and the bytes per element
+void Report(Container *type, const char *order, unsigned long size, unsigned long seed, double *best, double bytes)
+{
+	int present[OPERATIONS] = {1, type->contains != NULL, type->iterate != NULL, 1, 1};
+	printf("%s,%s,%lu,%lu", type->name, order, size, seed);
+	for(int i = 0; i < OPERATIONS; i++)
+	{
+		if(present[i]) printf(",%.2f", best[i]*1e9/size);
+		else printf(",");
+	}
+	if(Allocated()) printf(",%.2f\n", bytes);
+	else printf(",\n");
+}
+
+int main(int argc, char **argv)
+{
+	const char *only = argc > 1 ? argv[1] : "all";
+	unsigned long largest = argc > 2 ? strtoul(argv[2], NULL, 10) : 1000000;
+	int repetitions = argc > 3 ? atoi(argv[3]) : 3;
+	unsigned long seed = argc > 4 ? strtoul(argv[4], NULL, 10) : 1;
+	if(repetitions < 1) repetitions = 1;
+	Container containers[] =
+	{
+		{"avl", 0, Bench_AVLCreate, Bench_AVLInsert, Bench_AVLContains, Bench_AVLIterate, Bench_AVLDelete, Bench_AVLClear},
+		{"avl_specialized", 0, Bench_AVLCreate, Bench_UINT64Insert, Bench_UINT64Contains, Bench_AVLIterate, Bench_UINT64Delete, Bench_AVLClear},
+		{"cset", 0, Bench_CSETCreate, Bench_CSETInsert, Bench_CSETContains, Bench_CSETIterate, Bench_CSETDelete, Bench_CSETClear},
+		{"btree", 0, Bench_BTREECreate, Bench_BTREEInsert, Bench_BTREEContains, Bench_BTREEIterate, Bench_BTREEDelete, Bench_BTREEClear},
+		{"hash", 0, Bench_HASHCreate, Bench_HASHInsert, Bench_HASHContains, Bench_HASHIterate, Bench_HASHDelete, Bench_HASHClear},
+		{"cmap", 0, Bench_CMAPCreate, Bench_CMAPInsert, Bench_CMAPContains, Bench_CMAPIterate, Bench_CMAPDelete, Bench_CMAPClear},
+		{"pavl", 0, Bench_PAVLCreate, Bench_PAVLInsert, Bench_PAVLContains, Bench_PAVLIterate, Bench_PAVLDelete, Bench_PAVLClear},
+		{"list", 1, Bench_LISTCreate, Bench_LISTAppend, NULL, Bench_LISTIterate, Bench_LISTDequeue, Bench_LISTClear},
+		{"list", 2, Bench_LISTCreate, Bench_LISTAppend, NULL, Bench_LISTIterate, Bench_LISTPop, Bench_LISTClear},
+		{"deque", 1, Bench_DEQUECreate, Bench_DEQUEAppend, NULL, Bench_DEQUEIterate, Bench_DEQUEDequeue, Bench_DEQUEClear},
+		{"deque", 2, Bench_DEQUECreate, Bench_DEQUEAppend, NULL, Bench_DEQUEIterate, Bench_DEQUEPop, Bench_DEQUEClear},
+		{"ulist", 1, Bench_ULISTCreate, Bench_ULISTAppend, NULL, Bench_ULISTIterate, Bench_ULISTDequeue, Bench_ULISTClear},
+		{"ulist", 2, Bench_ULISTCreate, Bench_ULISTAppend, NULL, Bench_ULISTIterate, Bench_ULISTPop, Bench_ULISTClear},
+		{"queue", 1, Bench_QUEUECreate, Bench_QUEUEAppend, NULL, NULL, Bench_QUEUEDequeue, Bench_QUEUEClear}
+	};
+	printf("container,order,size,seed,insert_ns,lookup_ns,iterate_ns,delete_ns,clear_ns,bytes_per_element\n");
+	for(unsigned long c = 0; c < sizeof(containers)/sizeof(Container); c++)
+	{
+		Container *type = &containers[c];
+		if(strcmp(only, "all") && strcmp(only, type->name)) continue;
+		// sequences ignore the order of their keys, so they are filled once in sorted order
+		int orders_count = type->sequence ? 1 : sizeof(orders)/sizeof(char*);
+		for(int o = 0; o < orders_count; o++)
+		{
+			for(unsigned long size = 1000; size <= largest; size *= 10)
+			{
+				POLY_Polymorphic *keys = malloc(sizeof(POLY_Polymorphic)*size);
+				Order(keys, size, type->sequence ? 1 : o, seed);
+				double best[OPERATIONS];
+				double bytes = 0;
+				for(int i = 0; i < OPERATIONS; i++) best[i] = -1;
+				for(int r = 0; r < repetitions; r++)
+				{
+					double times[OPERATIONS] = {0};
+					Measure(type, keys, size, seed, times, &bytes);
+					for(int i = 0; i < OPERATIONS; i++) if(best[i] < 0 || times[i] < best[i]) best[i] = times[i];
+				}
+				free(keys);
+				Report(type, type->sequence == 1 ? "fifo" : type->sequence == 2 ? "lifo" : orders[o], size, seed, best, bytes);
+				fflush(stdout);
+			}
+		}
+	}
+	AVL_ReleasePool();
+	return 0;
+}
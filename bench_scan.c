@@ -0,0 +1,408 @@
+/*
+Benchmark for scanning text with compiled state machines
+
+Copyright (C) 2016 Kyle Gagner
+All Rights Reserved
+
+Compiles a tokenizer grammar, generates synthetic corpora and tokenizes them by maximal munch with each table layout,
+printing one CSV line per corpus and layout with throughput and, where perf_event_open is available, hardware counters
+usage: bench_scan [corpus] [megabytes] [repetitions]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "regex.h"
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+// number of hardware counters sampled
+#define COUNTERS 3
+
+// represents a corpus of UTF-16 text
+typedef struct
+{
+	UNICODE_Char *text;
+	unsigned long length;
+	unsigned long capacity;
+} Corpus;
+
+// represents a machine laid out as a table indexed by state and character class
+typedef struct
+{
+	unsigned short *classes;
+	unsigned long classes_count;
+	unsigned long *next;
+	unsigned long *accepts;
+} DenseTable;
+
+// represents a table layout and the routine scanning with it
+typedef struct
+{
+	const char *name;
+	unsigned long (*scan)(void *table, UNICODE_Char *text, unsigned long length);
+	void *table;
+} Layout;
+
+// represents a named corpus generator
+typedef struct
+{
+	const char *name;
+	void (*generate)(Corpus *corpus, unsigned long length);
+} Generator;
+
+// represents a set of hardware counters
+typedef struct
+{
+	int descriptors[COUNTERS];
+} Counters;
+
+// TOKENIZER GRAMMAR
+
+// writes an alternation of every character in a string, such as (a|b|c)
+void AlternateCharacters(char *buffer, const char *characters)
+{
+	char *out = buffer;
+	*out++ = '(';
+	for(const char *c = characters; *c; c++)
+	{
+		if(c != characters) *out++ = '|';
+		if(strchr("()|*?+.\\^$", *c)) *out++ = '\\';
+		*out++ = *c;
+	}
+	*out++ = ')';
+	*out = 0;
+}
+
+// widens text to a UTF-16 expression, the byte 0x01 stands for a run of Greek letters
+void SetExpression(REGEX_Expression *expression, const char *text, unsigned long accepts)
+{
+	unsigned long length = 0;
+	for(const char *c = text; *c; c++) length += *c == 1 ? 2*24 + 1 : 1;
+	UNICODE_Char *out = expression->expression = malloc(sizeof(UNICODE_Char)*(length + 1));
+	for(const char *c = text; *c; c++)
+	{
+		if(*c == 1)
+		{
+			*out++ = '(';
+			for(UNICODE_Char g = 0x3B1; g <= 0x3C9; g++)
+			{
+				if(g == 0x3C2) continue;
+				if(g != 0x3B1) *out++ = '|';
+				*out++ = g;
+			}
+			*out++ = ')';
+		}
+		else *out++ = (unsigned char)*c;
+	}
+	*out = 0;
+	expression->accepts = accepts;
+	expression->flags = 0;
+}
+
+// builds the grammar used for every corpus: identifiers, numbers, strings, whitespace, punctuation, keywords and Greek words
+void Grammar(REGEX_Expressions *expressions)
+{
+	static char letter[256], digit[256], space[256], punctuation[256], quoted[512];
+	static char identifier[1024], number[1024], string[1024], whitespace[512], greek[8];
+	AlternateCharacters(letter, "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_");
+	AlternateCharacters(digit, "0123456789");
+	AlternateCharacters(space, " \t\r\n");
+	AlternateCharacters(punctuation, "{}[]():;,=<>+-*/&|!.\\#%@'");
+	AlternateCharacters(quoted, "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 _-.:/[]=");
+	sprintf(identifier, "%s(%s|%s)*", letter, letter, digit);
+	sprintf(number, "\\-?%s+(\\.%s+)?", digit, digit);
+	sprintf(string, "\"%s*\"", quoted);
+	sprintf(whitespace, "%s+", space);
+	sprintf(greek, "\x01+");
+	const char *rules[] = {punctuation, whitespace, identifier, number, string, greek,
+		"if", "else", "while", "for", "return", "int", "char", "true", "false", "null", "ERROR", "INFO", "WARN"};
+	expressions->expressions_count = sizeof(rules)/sizeof(char*);
+	expressions->expressions = malloc(sizeof(REGEX_Expression)*expressions->expressions_count);
+	for(unsigned long n = 0; n < expressions->expressions_count; n++) SetExpression(&expressions->expressions[n], rules[n], n + 1);
+}
+
+// CORPORA
+
+// appends text to a corpus, the byte 0x01 stands for a Greek letter
+void Append(Corpus *corpus, const char *text, unsigned long *seed)
+{
+	unsigned long length = strlen(text);
+	if(corpus->length + length > corpus->capacity)
+	{
+		corpus->capacity = (corpus->length + length)*2;
+		corpus->text = realloc(corpus->text, sizeof(UNICODE_Char)*corpus->capacity);
+	}
+	for(unsigned long i = 0; i < length; i++)
+	{
+		if(text[i] == 1)
+		{
+			*seed = *seed*6364136223846793005UL + 1442695040888963407UL;
+			corpus->text[corpus->length++] = 0x3B1 + (*seed >> 33) % 17;
+		}
+		else corpus->text[corpus->length++] = (unsigned char)text[i];
+	}
+}
+
+// picks a reproducible pseudorandom entry from a list of strings
+const char *Pick(unsigned long *seed, const char **choices, unsigned long choices_count)
+{
+	*seed = *seed*6364136223846793005UL + 1442695040888963407UL;
+	return choices[(*seed >> 33) % choices_count];
+}
+
+// C-like source code
+void GenerateSource(Corpus *corpus, unsigned long length)
+{
+	const char *lines[] = {
+		"int main(int argc, char **argv)\n{\n",
+		"\tfor(unsigned long n = 0; n < count; n++) total += values[n] * 3;\n",
+		"\tif(node->left && node->left->height > height) return -1;\n",
+		"\telse printf(\"%lu states\\n\", machine->states_count);\n",
+		"\twhile(current) current = current->next; // walk the chain\n",
+		"\tchar buffer[512] = \"hello world\";\n}\n"};
+	unsigned long seed = 1;
+	while(corpus->length < length) Append(corpus, Pick(&seed, lines, sizeof(lines)/sizeof(char*)), &seed);
+}
+
+// JSON documents
+void GenerateJSON(Corpus *corpus, unsigned long length)
+{
+	const char *values[] = {
+		"{\"id\": 12345, \"name\": \"widget\", \"price\": 19.99, \"tags\": [\"a\", \"b\"]}",
+		"{\"ok\": true, \"items\": [1, 2, 3, 4, 5], \"next\": null}",
+		"{\"user\": {\"login\": \"kgagner\", \"followers\": 1024}, \"score\": -0.5}",
+		",\n", "[", "]"};
+	unsigned long seed = 2;
+	while(corpus->length < length) Append(corpus, Pick(&seed, values, sizeof(values)/sizeof(char*)), &seed);
+}
+
+// server log lines
+void GenerateLogs(Corpus *corpus, unsigned long length)
+{
+	const char *lines[] = {
+		"2016-03-14 12:00:01 INFO server started on port 8080\n",
+		"2016-03-14 12:00:02 WARN slow request path=/api/v1/items took 1250 ms\n",
+		"2016-03-14 12:00:03 ERROR connection reset by peer 10.0.0.12\n",
+		"2016-03-14 12:00:04 INFO user=42 action=login result=ok\n"};
+	unsigned long seed = 3;
+	while(corpus->length < length) Append(corpus, Pick(&seed, lines, sizeof(lines)/sizeof(char*)), &seed);
+}
+
+// prose mixing ASCII words with Greek words outside the ASCII range
+void GenerateUTF16(Corpus *corpus, unsigned long length)
+{
+	const char *words[] = {"\x01\x01\x01\x01 ", "\x01\x01\x01\x01\x01\x01\x01 ", "the ", "\x01\x01 ", "alpha ", "\x01\x01\x01\x01\x01, ", ".\n"};
+	unsigned long seed = 4;
+	while(corpus->length < length) Append(corpus, Pick(&seed, words, sizeof(words)/sizeof(char*)), &seed);
+}
+
+// TABLE LAYOUTS
+
+// tokenizes by maximal munch following the machine's sorted transition lists with binary search
+// each token starts from the start state for the context of the character before it and assertions are checked as it is scanned
+// returns the number of tokens
+unsigned long ScanSparse(void *table, UNICODE_Char *text, unsigned long length)
+{
+	REGEX_Machine *machine = table;
+	unsigned long tokens = 0;
+	unsigned long position = 0;
+	while(position < length)
+	{
+		unsigned long state = machine->starts[position ? REGEX_Context(text[position - 1]) : REGEX_TEXT];
+		unsigned long end = position + 1;
+		for(unsigned long i = position; i < length; i++)
+		{
+			REGEX_State *current = &machine->states[state];
+			int low = 0, high = current->transitions_count - 1;
+			while(low <= high)
+			{
+				int middle = (low + high)/2;
+				if(current->transitions[middle].on < text[i]) low = middle + 1;
+				else high = middle - 1;
+			}
+			if(low >= current->transitions_count || current->transitions[low].on != text[i]) break;
+			state = current->transitions[low].to;
+			if(REGEX_Accepts(&machine->states[state], i + 1 < length ? REGEX_Context(text[i + 1]) : REGEX_TEXT)) end = i + 1;
+		}
+		tokens++;
+		position = end;
+	}
+	return tokens;
+}
+
+// tokenizes by maximal munch through a dense table, one class lookup and one table lookup per character
+// the grammar has no assertions, so the dense layout keeps only the start state and the unconditional accepts values
+// returns the number of tokens
+unsigned long ScanDense(void *table, UNICODE_Char *text, unsigned long length)
+{
+	DenseTable *dense = table;
+	unsigned long tokens = 0;
+	unsigned long position = 0;
+	while(position < length)
+	{
+		unsigned long state = 0;
+		unsigned long end = position + 1;
+		for(unsigned long i = position; i < length; i++)
+		{
+			unsigned long next = dense->next[state*dense->classes_count + dense->classes[text[i]]];
+			if(!next) break;
+			state = next - 1;
+			if(dense->accepts[state]) end = i + 1;
+		}
+		tokens++;
+		position = end;
+	}
+	return tokens;
+}
+
+// lays a machine out densely, every character used by a transition gets a class and all others share class 0
+DenseTable *CreateDense(REGEX_Machine *machine)
+{
+	DenseTable *dense = malloc(sizeof(DenseTable));
+	dense->classes = calloc(65536, sizeof(unsigned short));
+	dense->classes_count = 1;
+	for(unsigned long n = 0; n < machine->states_count; n++)
+		for(unsigned short i = 0; i < machine->states[n].transitions_count; i++)
+			if(!dense->classes[machine->states[n].transitions[i].on]) dense->classes[machine->states[n].transitions[i].on] = dense->classes_count++;
+	dense->next = calloc(machine->states_count*dense->classes_count, sizeof(unsigned long));
+	dense->accepts = malloc(sizeof(unsigned long)*machine->states_count);
+	for(unsigned long n = 0; n < machine->states_count; n++)
+	{
+		dense->accepts[n] = machine->states[n].accepts;
+		for(unsigned short i = 0; i < machine->states[n].transitions_count; i++)
+			dense->next[n*dense->classes_count + dense->classes[machine->states[n].transitions[i].on]] = machine->states[n].transitions[i].to + 1;
+	}
+	return dense;
+}
+
+// frees a dense table
+void DestroyDense(DenseTable *dense)
+{
+	free(dense->classes);
+	free(dense->next);
+	free(dense->accepts);
+	free(dense);
+}
+
+// MEASUREMENT
+
+// opens branch miss, cache miss and instruction counters for this thread, any that are unavailable are left closed
+void OpenCounters(Counters *counters)
+{
+	for(int n = 0; n < COUNTERS; n++) counters->descriptors[n] = -1;
+#ifdef __linux__
+	unsigned long long configs[COUNTERS] = {PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_INSTRUCTIONS};
+	for(int n = 0; n < COUNTERS; n++)
+	{
+		struct perf_event_attr attributes;
+		memset(&attributes, 0, sizeof(attributes));
+		attributes.type = PERF_TYPE_HARDWARE;
+		attributes.size = sizeof(attributes);
+		attributes.config = configs[n];
+		attributes.disabled = 1;
+		attributes.exclude_kernel = 1;
+		attributes.exclude_hv = 1;
+		counters->descriptors[n] = syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+	}
+#endif
+}
+
+// resets and enables or disables the open counters
+void ToggleCounters(Counters *counters, int enable)
+{
+#ifdef __linux__
+	for(int n = 0; n < COUNTERS; n++)
+	{
+		if(counters->descriptors[n] < 0) continue;
+		if(enable) ioctl(counters->descriptors[n], PERF_EVENT_IOC_RESET, 0);
+		ioctl(counters->descriptors[n], enable ? PERF_EVENT_IOC_ENABLE : PERF_EVENT_IOC_DISABLE, 0);
+	}
+#endif
+}
+
+// formats a counter for CSV output, empty if unavailable
+void FormatCounter(Counters *counters, int n, char *buffer)
+{
+	buffer[0] = 0;
+#ifdef __linux__
+	long long value;
+	if(counters->descriptors[n] >= 0 && read(counters->descriptors[n], &value, sizeof(value)) == sizeof(value)) sprintf(buffer, "%lld", value);
+#endif
+}
+
+// closes the open counters
+void CloseCounters(Counters *counters)
+{
+#ifdef __linux__
+	for(int n = 0; n < COUNTERS; n++) if(counters->descriptors[n] >= 0) close(counters->descriptors[n]);
+#endif
+}
+
+// reads a monotonic clock
+// returns the time in seconds
+double Now()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec*1e-9;
+}
+
+int main(int argc, char **argv)
+{
+	Generator generators[] = {{"source", GenerateSource}, {"json", GenerateJSON}, {"logs", GenerateLogs}, {"utf16", GenerateUTF16}};
+	const char *filter = argc > 1 ? argv[1] : NULL;
+	double megabytes = argc > 2 ? atof(argv[2]) : 16;
+	int repetitions = argc > 3 ? atoi(argv[3]) : 3;
+	if(repetitions < 1) repetitions = 1;
+	REGEX_Expressions expressions;
+	Grammar(&expressions);
+	REGEX_Machine *machine = REGEX_CreateMachine(&expressions);
+	DenseTable *dense = CreateDense(machine);
+	Layout layouts[] = {{"sparse", ScanSparse, machine}, {"dense", ScanDense, dense}};
+	Counters counters;
+	OpenCounters(&counters);
+	printf("corpus,layout,states,megabytes,tokens,seconds,mb_per_s,ns_per_char,branch_misses,cache_misses,instructions\n");
+	for(unsigned long g = 0; g < sizeof(generators)/sizeof(Generator); g++)
+	{
+		if(filter && strcmp(filter, "all") && strcmp(filter, generators[g].name)) continue;
+		Corpus corpus = {NULL, 0, 0};
+		generators[g].generate(&corpus, (unsigned long)(megabytes*1048576/sizeof(UNICODE_Char)));
+		double size = corpus.length*sizeof(UNICODE_Char)/1048576.0;
+		for(unsigned long l = 0; l < sizeof(layouts)/sizeof(Layout); l++)
+		{
+			double best = -1;
+			unsigned long tokens = 0;
+			char counted[COUNTERS][32];
+			for(int r = 0; r < repetitions; r++)
+			{
+				ToggleCounters(&counters, 1);
+				double began = Now();
+				tokens = layouts[l].scan(layouts[l].table, corpus.text, corpus.length);
+				double seconds = Now() - began;
+				ToggleCounters(&counters, 0);
+				if(best < 0 || seconds < best)
+				{
+					best = seconds;
+					for(int n = 0; n < COUNTERS; n++) FormatCounter(&counters, n, counted[n]);
+				}
+			}
+			printf("%s,%s,%lu,%.2f,%lu,%.4f,%.1f,%.3f,%s,%s,%s\n", generators[g].name, layouts[l].name, machine->states_count, size, tokens,
+				best, size/best, best*1e9/corpus.length, counted[0], counted[1], counted[2]);
+			fflush(stdout);
+		}
+		free(corpus.text);
+	}
+	CloseCounters(&counters);
+	DestroyDense(dense);
+	REGEX_DestroyMachine(machine);
+	for(unsigned long n = 0; n < expressions.expressions_count; n++) free(expressions.expressions[n].expression);
+	free(expressions.expressions);
+	return 0;
+}
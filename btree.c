@@ -0,0 +1,396 @@
+/*
+Source file for B-tree set or tree map implementation
+
+Copyright (C) 2016 Kyle Gagner
+All Rights Reserved
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "btree.h"
+
+BTREE_Tree *BTREE_Initialize(BTREE_Tree *tree, AVL_Destroyer kfree, AVL_Destroyer vfree, AVL_Comparator comparator)
+{
+	tree->root = NULL;
+	tree->size = 0;
+	tree->comparator = comparator;
+	tree->kfree = kfree;
+	tree->vfree = vfree;
+	return tree;
+}
+
+// helper function allocates an empty cache line aligned node, leaves are allocated without room for children
+// takes whether the node is a leaf
+// returns a pointer to the node
+BTREE_Node *BTREE_CreateNode(int leaf)
+{
+	size_t size = leaf ? sizeof(BTREE_Node) : sizeof(BTREE_Internal);
+	size = (size + BTREE_ALIGNMENT - 1)/BTREE_ALIGNMENT*BTREE_ALIGNMENT;
+	BTREE_Node *node = aligned_alloc(BTREE_ALIGNMENT, size);
+	node->count = 0;
+	node->leaf = leaf;
+	return node;
+}
+
+// helper function frees memory of node, its keys and values, and its children recursively
+// takes a pointer to the tree and the node to destroy
+void BTREE_DestroyNode(BTREE_Tree *tree, BTREE_Node *node)
+{
+	if(!node) return;
+	for(int i = 0; i < node->count; i++)
+	{
+		if(tree->kfree) tree->kfree(node->keys[i]);
+		if(tree->vfree) tree->vfree(node->values[i]);
+	}
+	if(!node->leaf) for(int i = 0; i <= node->count; i++) BTREE_DestroyNode(tree, BTREE_CHILDREN(node)[i]);
+	free(node);
+}
+
+void BTREE_Clear(BTREE_Tree *tree)
+{
+	BTREE_DestroyNode(tree, tree->root);
+	tree->root = NULL;
+	tree->size = 0;
+}
+
+// helper function finds the first key in a node not less than a key by binary search
+// takes a pointer to the tree, the node, the key, and a pointer set to whether the key was found
+// returns the index of the key, or of the child that may contain it
+int BTREE_Search(BTREE_Tree *tree, BTREE_Node *node, POLY_Polymorphic key, int *found)
+{
+	int low = 0;
+	int high = node->count;
+	*found = 0;
+	while(low < high)
+	{
+		int middle = (low + high)/2;
+		int comparison = tree->comparator(key, node->keys[middle]);
+		if(comparison > 0) low = middle + 1;
+		else if(comparison < 0) high = middle;
+		else
+		{
+			*found = 1;
+			return middle;
+		}
+	}
+	return low;
+}
+
+// helper function gets the node and index holding a key
+// takes a pointer to the tree to search, the key, and a pointer set to the index
+// returns a pointer to the node or NULL if not found
+BTREE_Node *BTREE_GetNode(BTREE_Tree *tree, POLY_Polymorphic key, int *index)
+{
+	BTREE_Node *current = tree->root;
+	while(current)
+	{
+		int found;
+		*index = BTREE_Search(tree, current, key, &found);
+		if(found) return current;
+		if(current->leaf) return NULL;
+		current = BTREE_CHILDREN(current)[*index];
+	}
+	return NULL;
+}
+
+POLY_Polymorphic BTREE_Get(BTREE_Tree *tree, POLY_Polymorphic key)
+{
+	int index;
+	BTREE_Node *node = BTREE_GetNode(tree, key, &index);
+	if(node) return node->values[index];
+	else return POLY_DEFAULT;
+}
+
+// helper function splits the full child of a node in two, moving its middle key up into the node
+// takes a pointer to the parent node, which must not be full, and the index of the child
+void BTREE_SplitChild(BTREE_Node *parent, int index)
+{
+	BTREE_Node *left = BTREE_CHILDREN(parent)[index];
+	BTREE_Node *right = BTREE_CreateNode(left->leaf);
+	right->count = BTREE_DEGREE - 1;
+	memcpy(right->keys, left->keys + BTREE_DEGREE, sizeof(POLY_Polymorphic)*(BTREE_DEGREE - 1));
+	memcpy(right->values, left->values + BTREE_DEGREE, sizeof(POLY_Polymorphic)*(BTREE_DEGREE - 1));
+	if(!left->leaf) memcpy(BTREE_CHILDREN(right), BTREE_CHILDREN(left) + BTREE_DEGREE, sizeof(BTREE_Node*)*BTREE_DEGREE);
+	left->count = BTREE_DEGREE - 1;
+	memmove(parent->keys + index + 1, parent->keys + index, sizeof(POLY_Polymorphic)*(parent->count - index));
+	memmove(parent->values + index + 1, parent->values + index, sizeof(POLY_Polymorphic)*(parent->count - index));
+	memmove(BTREE_CHILDREN(parent) + index + 2, BTREE_CHILDREN(parent) + index + 1, sizeof(BTREE_Node*)*(parent->count - index));
+	parent->keys[index] = left->keys[BTREE_DEGREE - 1];
+	parent->values[index] = left->values[BTREE_DEGREE - 1];
+	BTREE_CHILDREN(parent)[index + 1] = right;
+	parent->count++;
+}
+
+void BTREE_Set(BTREE_Tree *tree, POLY_Polymorphic key, POLY_Polymorphic value)
+{
+	if(!tree->root) tree->root = BTREE_CreateNode(1);
+	if(tree->root->count == BTREE_KEYS)
+	{
+		BTREE_Node *root = BTREE_CreateNode(0);
+		BTREE_CHILDREN(root)[0] = tree->root;
+		tree->root = root;
+		BTREE_SplitChild(root, 0);
+	}
+	BTREE_Node *current = tree->root;
+	while(1)
+	{
+		int found;
+		int index = BTREE_Search(tree, current, key, &found);
+		if(found)
+		{
+			if(tree->vfree) tree->vfree(current->values[index]);
+			current->values[index] = value;
+			return;
+		}
+		if(current->leaf)
+		{
+			memmove(current->keys + index + 1, current->keys + index, sizeof(POLY_Polymorphic)*(current->count - index));
+			memmove(current->values + index + 1, current->values + index, sizeof(POLY_Polymorphic)*(current->count - index));
+			current->keys[index] = key;
+			current->values[index] = value;
+			current->count++;
+			tree->size++;
+			return;
+		}
+		if(BTREE_CHILDREN(current)[index]->count == BTREE_KEYS)
+		{
+			BTREE_SplitChild(current, index);
+			int comparison = tree->comparator(key, current->keys[index]);
+			if(!comparison)
+			{
+				if(tree->vfree) tree->vfree(current->values[index]);
+				current->values[index] = value;
+				return;
+			}
+			if(comparison > 0) index++;
+		}
+		current = BTREE_CHILDREN(current)[index];
+	}
+}
+
+void BTREE_Insert(BTREE_Tree *tree, POLY_Polymorphic key)
+{
+	BTREE_Set(tree, key, POLY_DEFAULT);
+}
+
+// helper function merges a child of a node with its right sibling and the key between them
+// takes a pointer to the parent node and the index of the left child
+void BTREE_Merge(BTREE_Node *parent, int index)
+{
+	BTREE_Node *left = BTREE_CHILDREN(parent)[index];
+	BTREE_Node *right = BTREE_CHILDREN(parent)[index + 1];
+	left->keys[left->count] = parent->keys[index];
+	left->values[left->count] = parent->values[index];
+	memcpy(left->keys + left->count + 1, right->keys, sizeof(POLY_Polymorphic)*right->count);
+	memcpy(left->values + left->count + 1, right->values, sizeof(POLY_Polymorphic)*right->count);
+	if(!left->leaf) memcpy(BTREE_CHILDREN(left) + left->count + 1, BTREE_CHILDREN(right), sizeof(BTREE_Node*)*(right->count + 1));
+	left->count += right->count + 1;
+	memmove(parent->keys + index, parent->keys + index + 1, sizeof(POLY_Polymorphic)*(parent->count - index - 1));
+	memmove(parent->values + index, parent->values + index + 1, sizeof(POLY_Polymorphic)*(parent->count - index - 1));
+	memmove(BTREE_CHILDREN(parent) + index + 1, BTREE_CHILDREN(parent) + index + 2, sizeof(BTREE_Node*)*(parent->count - index - 1));
+	parent->count--;
+	free(right);
+}
+
+// helper function makes sure a child of a node holds more than the minimum number of keys before descending into it,
+// borrowing a key through the parent from a sibling or merging with a sibling
+// takes a pointer to the parent node and the index of the child
+// returns the index of the child to descend into, which changes if the child was merged into its left sibling
+int BTREE_Fill(BTREE_Node *parent, int index)
+{
+	BTREE_Node *child = BTREE_CHILDREN(parent)[index];
+	if(child->count >= BTREE_DEGREE) return index;
+	if(index > 0 && BTREE_CHILDREN(parent)[index - 1]->count >= BTREE_DEGREE)
+	{
+		BTREE_Node *sibling = BTREE_CHILDREN(parent)[index - 1];
+		memmove(child->keys + 1, child->keys, sizeof(POLY_Polymorphic)*child->count);
+		memmove(child->values + 1, child->values, sizeof(POLY_Polymorphic)*child->count);
+		if(!child->leaf) memmove(BTREE_CHILDREN(child) + 1, BTREE_CHILDREN(child), sizeof(BTREE_Node*)*(child->count + 1));
+		child->keys[0] = parent->keys[index - 1];
+		child->values[0] = parent->values[index - 1];
+		if(!child->leaf) BTREE_CHILDREN(child)[0] = BTREE_CHILDREN(sibling)[sibling->count];
+		parent->keys[index - 1] = sibling->keys[sibling->count - 1];
+		parent->values[index - 1] = sibling->values[sibling->count - 1];
+		sibling->count--;
+		child->count++;
+		return index;
+	}
+	if(index < parent->count && BTREE_CHILDREN(parent)[index + 1]->count >= BTREE_DEGREE)
+	{
+		BTREE_Node *sibling = BTREE_CHILDREN(parent)[index + 1];
+		child->keys[child->count] = parent->keys[index];
+		child->values[child->count] = parent->values[index];
+		if(!child->leaf) BTREE_CHILDREN(child)[child->count + 1] = BTREE_CHILDREN(sibling)[0];
+		parent->keys[index] = sibling->keys[0];
+		parent->values[index] = sibling->values[0];
+		memmove(sibling->keys, sibling->keys + 1, sizeof(POLY_Polymorphic)*(sibling->count - 1));
+		memmove(sibling->values, sibling->values + 1, sizeof(POLY_Polymorphic)*(sibling->count - 1));
+		if(!sibling->leaf) memmove(BTREE_CHILDREN(sibling), BTREE_CHILDREN(sibling) + 1, sizeof(BTREE_Node*)*sibling->count);
+		sibling->count--;
+		child->count++;
+		return index;
+	}
+	if(index < parent->count)
+	{
+		BTREE_Merge(parent, index);
+		return index;
+	}
+	BTREE_Merge(parent, index - 1);
+	return index - 1;
+}
+
+void BTREE_Delete(BTREE_Tree *tree, POLY_Polymorphic key)
+{
+	int index;
+	if(!BTREE_GetNode(tree, key, &index)) return;
+	tree->size--;
+	BTREE_Node *current = tree->root;
+	// the key and value are destroyed once removed, since the key may move down into a merged child and be compared again
+	POLY_Polymorphic removed_key, removed_value;
+	int kept = 0;
+	while(1)
+	{
+		int found;
+		index = BTREE_Search(tree, current, key, &found);
+		if(found && !kept)
+		{
+			removed_key = current->keys[index];
+			removed_value = current->values[index];
+			kept = 1;
+		}
+		if(found && current->leaf)
+		{
+			memmove(current->keys + index, current->keys + index + 1, sizeof(POLY_Polymorphic)*(current->count - index - 1));
+			memmove(current->values + index, current->values + index + 1, sizeof(POLY_Polymorphic)*(current->count - index - 1));
+			current->count--;
+			break;
+		}
+		if(found)
+		{
+			// replace the key by its predecessor or successor and go on to remove that from the child it came from
+			BTREE_Node *left = BTREE_CHILDREN(current)[index];
+			BTREE_Node *right = BTREE_CHILDREN(current)[index + 1];
+			if(left->count >= BTREE_DEGREE)
+			{
+				BTREE_Node *predecessor = left;
+				while(!predecessor->leaf) predecessor = BTREE_CHILDREN(predecessor)[predecessor->count];
+				current->keys[index] = key = predecessor->keys[predecessor->count - 1];
+				current->values[index] = predecessor->values[predecessor->count - 1];
+				current = left;
+			}
+			else if(right->count >= BTREE_DEGREE)
+			{
+				BTREE_Node *successor = right;
+				while(!successor->leaf) successor = BTREE_CHILDREN(successor)[0];
+				current->keys[index] = key = successor->keys[0];
+				current->values[index] = successor->values[0];
+				current = right;
+			}
+			else
+			{
+				// the key moves down into the merged child, where it is found again and removed
+				BTREE_Merge(current, index);
+				current = left;
+			}
+			continue;
+		}
+		current = BTREE_CHILDREN(current)[BTREE_Fill(current, index)];
+	}
+	if(!tree->root->count)
+	{
+		BTREE_Node *root = tree->root;
+		tree->root = root->leaf ? NULL : BTREE_CHILDREN(root)[0];
+		free(root);
+	}
+	if(tree->kfree) tree->kfree(removed_key);
+	if(tree->vfree) tree->vfree(removed_value);
+}
+
+int BTREE_Contains(BTREE_Tree *tree, POLY_Polymorphic key)
+{
+	int index;
+	return BTREE_GetNode(tree, key, &index) ? 1 : 0;
+}
+
+unsigned long BTREE_Size(BTREE_Tree *tree)
+{
+	return tree->size;
+}
+
+BTREE_Iterator *BTREE_InitializeIterator(BTREE_Tree *tree, BTREE_Iterator *iterator)
+{
+	iterator->tree = tree;
+	iterator->depth = -1;
+	return iterator;
+}
+
+// helper function pushes a node and the leftmost path below it onto an iterator's path
+// takes a pointer to the iterator and the node
+void BTREE_Descend(BTREE_Iterator *iterator, BTREE_Node *node)
+{
+	while(1)
+	{
+		iterator->depth++;
+		iterator->nodes[iterator->depth] = node;
+		iterator->indices[iterator->depth] = 0;
+		if(node->leaf) break;
+		node = BTREE_CHILDREN(node)[0];
+	}
+}
+
+int BTREE_Next(BTREE_Iterator *iterator)
+{
+	if(iterator->depth < 0)
+	{
+		if(!iterator->tree->root || !iterator->tree->root->count) return 0;
+		BTREE_Descend(iterator, iterator->tree->root);
+		return 1;
+	}
+	BTREE_Node *node = iterator->nodes[iterator->depth];
+	if(!node->leaf)
+	{
+		BTREE_Descend(iterator, BTREE_CHILDREN(node)[++iterator->indices[iterator->depth]]);
+		return 1;
+	}
+	if(++iterator->indices[iterator->depth] < node->count) return 1;
+	do iterator->depth--;
+	while(iterator->depth >= 0 && iterator->indices[iterator->depth] >= iterator->nodes[iterator->depth]->count);
+	return iterator->depth >= 0;
+}
+
+POLY_Polymorphic BTREE_Key(BTREE_Iterator *iterator)
+{
+	if(iterator->depth >= 0) return iterator->nodes[iterator->depth]->keys[iterator->indices[iterator->depth]];
+	else return POLY_DEFAULT;
+}
+
+POLY_Polymorphic BTREE_Value(BTREE_Iterator *iterator)
+{
+	if(iterator->depth >= 0) return iterator->nodes[iterator->depth]->values[iterator->indices[iterator->depth]];
+	else return POLY_DEFAULT;
+}
+
+void BTREE_Reset(BTREE_Iterator *iterator)
+{
+	iterator->depth = -1;
+}
+
+int BTREE_DeepComparator(POLY_Polymorphic key1, POLY_Polymorphic key2)
+{
+	if (BTREE_POLYTREE(key1)->size < BTREE_POLYTREE(key2)->size) return -1;
+	else if (BTREE_POLYTREE(key1)->size > BTREE_POLYTREE(key2)->size) return 1;
+	BTREE_Iterator iter1;
+	BTREE_InitializeIterator(BTREE_POLYTREE(key1), &iter1);
+	BTREE_Iterator iter2;
+	BTREE_InitializeIterator(BTREE_POLYTREE(key2), &iter2);
+	int cmp = 0;
+	while(BTREE_Next(&iter1) && BTREE_Next(&iter2))
+		if((cmp = BTREE_POLYTREE(key1)->comparator(BTREE_Key(&iter1), BTREE_Key(&iter2))) != 0) break;
+	return cmp;
+}
+
+void BTREE_Destroy(POLY_Polymorphic item)
+{
+	BTREE_Clear(BTREE_POLYTREE(item));
+	free(BTREE_POLYTREE(item));
+}
@@ -0,0 +1,143 @@
+/*
+Header file for B-tree set or tree map implementation
+
+Copyright (C) 2016 Kyle Gagner
+All Rights Reserved
+*/
+
+// for polymorphism
+#include "poly.h"
+// for comparator and destroyer types
+#include "avl.h"
+
+// include guard
+#ifndef BTREE_H
+#define BTREE_H
+
+// minimum degree of the tree, every node but the root holds between BTREE_DEGREE - 1 and 2*BTREE_DEGREE - 1 keys
+#define BTREE_DEGREE 8
+
+// maximum number of keys held by a node
+#define BTREE_KEYS (2*BTREE_DEGREE - 1)
+
+// maximum depth of a tree, enough for any number of keys that fits in memory
+#define BTREE_DEPTH 24
+
+// alignment of nodes, the size of a cache line
+#define BTREE_ALIGNMENT 64
+
+// casting polymorphism
+#define BTREE_POLYTREE(value) ((BTREE_Tree*)value.ref)
+
+// gets the children of an internal node
+#define BTREE_CHILDREN(node) (((BTREE_Internal*)(node))->children)
+
+// represents a node in a B-tree, keys are kept together so a search within a node touches as few cache lines as possible
+// a leaf is just this, an internal node is a BTREE_Internal beginning with it
+typedef struct BTREE_Node
+{
+	POLY_Polymorphic keys[BTREE_KEYS];
+	unsigned short count;
+	unsigned short leaf;
+	POLY_Polymorphic values[BTREE_KEYS];
+} BTREE_Node;
+
+// represents an internal node in a B-tree, leaves are allocated without the children array
+typedef struct BTREE_Internal
+{
+	BTREE_Node node;
+	BTREE_Node *children[BTREE_KEYS + 1];
+} BTREE_Internal;
+
+// represents a B-tree
+typedef struct BTREE_Tree
+{
+	BTREE_Node *root;
+	unsigned long size;
+	AVL_Comparator comparator;
+	AVL_Destroyer kfree;
+	AVL_Destroyer vfree;
+} BTREE_Tree;
+
+// represents an inorder iterator for a B-tree
+// the iterator keeps the path from the root to the current key
+typedef struct BTREE_Iterator
+{
+	BTREE_Tree *tree;
+	BTREE_Node *nodes[BTREE_DEPTH];
+	unsigned short indices[BTREE_DEPTH];
+	int depth;
+} BTREE_Iterator;
+
+// initialize a tree
+// takes a pointer to the memory to initialize, the functions used to destroy keys, destroy values, and compare keys
+// kfree and vfree may be NULL
+// returns a pointer to the tree
+BTREE_Tree *BTREE_Initialize(BTREE_Tree *tree, AVL_Destroyer kfree, AVL_Destroyer vfree, AVL_Comparator comparator);
+
+// remove all items from a tree and free associate memory
+// takes a pointer to the tree
+void BTREE_Clear(BTREE_Tree *tree);
+
+// get the value associated with a key
+// takes a pointer to the tree to search and the key
+// returns the value or POLY_DEFAULT if not found
+POLY_Polymorphic BTREE_Get(BTREE_Tree *tree, POLY_Polymorphic key);
+
+// set the value associated with a key
+// takes a pointer to the tree to search and the key and value
+void BTREE_Set(BTREE_Tree *tree, POLY_Polymorphic key, POLY_Polymorphic value);
+
+// insert a key into a tree with no associated value
+// takes a pointer to the tree to search and the key
+void BTREE_Insert(BTREE_Tree *tree, POLY_Polymorphic key);
+
+// delete a key from a tree
+// takes a pointer to the tree to search and the key
+void BTREE_Delete(BTREE_Tree *tree, POLY_Polymorphic key);
+
+// determines whether a tree contains a key
+// takes a pointer to the tree to search and the key
+// returns 1 if the tree contains the key, returns 0 otherwise
+int BTREE_Contains(BTREE_Tree *tree, POLY_Polymorphic key);
+
+// gets the size of a tree
+// takes a pointer to the tree
+// returns the number of items in the tree
+unsigned long BTREE_Size(BTREE_Tree *tree);
+
+// initializes an iterator for a tree
+// takes a pointer to the tree to iterate over and the memory to initialize
+// returns an iterator for that tree
+BTREE_Iterator *BTREE_InitializeIterator(BTREE_Tree *tree, BTREE_Iterator *iterator);
+
+// gets the next element from an iterator
+// takes a pointer to the iterator
+// returns 0 if the end has been reached, 1 otherwise
+int BTREE_Next(BTREE_Iterator *iterator);
+
+// gets the key of the current element of an iterator
+// takes a pointer to the iterator
+// returns the key
+POLY_Polymorphic BTREE_Key(BTREE_Iterator *iterator);
+
+// gets the value of the current element of an iterator
+// takes a pointer to the iterator
+// returns the value
+POLY_Polymorphic BTREE_Value(BTREE_Iterator *iterator);
+
+// resets an iterator to the beginning
+// takes a pointer to the iterator
+void BTREE_Reset(BTREE_Iterator *iterator);
+
+// a function to do a deep comparison of two trees, note values are ignored, only keys are considered
+// the key comparator for the first tree will be used to compare keys between the trees
+// takes pointers to the two trees to compare
+// returns the result of the comparison
+int BTREE_DeepComparator(POLY_Polymorphic key1, POLY_Polymorphic key2);
+
+// a function to clear a tree and free the pointer to the tree
+// takes a pointer to the tree to destroy
+void BTREE_Destroy(POLY_Polymorphic item);
+
+#endif
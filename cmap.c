@@ -0,0 +1,386 @@
+/*
+Source file for concurrent read-mostly tree map implementation
+
+Copyright (C) 2016 Kyle Gagner
+All Rights Reserved
+*/
+
+#include <stdlib.h>
+#include "cmap.h"
+
+// garbage whose key should be destroyed
+#define DROPKEY 1
+
+// garbage whose value should be destroyed
+#define DROPVALUE 2
+
+CMAP_Map *CMAP_Initialize(CMAP_Map *map, AVL_Destroyer kfree, AVL_Destroyer vfree, AVL_Comparator comparator)
+{
+	atomic_init(&map->root, NULL);
+	atomic_init(&map->size, 0);
+	// epoch 0 marks a reader which is outside
+	atomic_init(&map->epoch, 1);
+	pthread_mutex_init(&map->lock, NULL);
+	map->readers = NULL;
+	map->garbage = NULL;
+	map->retiring = NULL;
+	map->retiring_count = 0;
+	map->retiring_capacity = 0;
+	map->comparator = comparator;
+	map->kfree = kfree;
+	map->vfree = vfree;
+	return map;
+}
+
+// helper function frees memory of a tree, its keys and values
+// takes a pointer to the map and the root of the tree
+void CMAP_DestroyTree(CMAP_Map *map, CMAP_Node *node)
+{
+	if(!node) return;
+	CMAP_DestroyTree(map, node->left);
+	CMAP_DestroyTree(map, node->right);
+	if(map->kfree) map->kfree(node->key);
+	if(map->vfree) map->vfree(node->value);
+	free(node);
+}
+
+// helper function frees garbage which no reader can still be looking at, must be called by a writer
+// takes a pointer to the map
+void CMAP_Reclaim(CMAP_Map *map)
+{
+	unsigned long oldest = atomic_load(&map->epoch);
+	for(CMAP_Reader *reader = map->readers; reader; reader = reader->next)
+	{
+		unsigned long epoch = atomic_load(&reader->epoch);
+		if(epoch && epoch < oldest) oldest = epoch;
+	}
+	// garbage is listed newest first, so everything after the first reclaimable garbage is reclaimable too
+	CMAP_Garbage **link = &map->garbage;
+	while(*link && (*link)->epoch >= oldest) link = &(*link)->next;
+	CMAP_Garbage *garbage = *link;
+	*link = NULL;
+	while(garbage)
+	{
+		CMAP_Garbage *next = garbage->next;
+		for(unsigned long i = 0; i < garbage->nodes_count; i++) free(garbage->nodes[i]);
+		CMAP_DestroyTree(map, garbage->tree);
+		if((garbage->drop & DROPKEY) && map->kfree) map->kfree(garbage->key);
+		if((garbage->drop & DROPVALUE) && map->vfree) map->vfree(garbage->value);
+		free(garbage);
+		garbage = next;
+	}
+}
+
+// helper function publishes a new version of a map and retires the memory it replaced, must be called by a writer
+// takes a pointer to the map, the new root, the root of a whole tree to retire or NULL,
+// and a key and value to retire according to the DROPKEY and DROPVALUE bits of drop
+void CMAP_Publish(CMAP_Map *map, CMAP_Node *root, CMAP_Node *tree, POLY_Polymorphic key, POLY_Polymorphic value, int drop)
+{
+	atomic_store(&map->root, root);
+	// readers entering from now on see the new root, so only readers which entered before can see the retired memory
+	unsigned long epoch = atomic_fetch_add(&map->epoch, 1);
+	CMAP_Garbage *garbage = malloc(sizeof(CMAP_Garbage) + sizeof(CMAP_Node*)*map->retiring_count);
+	garbage->epoch = epoch;
+	garbage->tree = tree;
+	garbage->key = key;
+	garbage->value = value;
+	garbage->drop = drop;
+	garbage->nodes_count = map->retiring_count;
+	for(unsigned long i = 0; i < map->retiring_count; i++) garbage->nodes[i] = map->retiring[i];
+	map->retiring_count = 0;
+	garbage->next = map->garbage;
+	map->garbage = garbage;
+	CMAP_Reclaim(map);
+}
+
+void CMAP_Clear(CMAP_Map *map)
+{
+	pthread_mutex_lock(&map->lock);
+	CMAP_Node *root = atomic_load(&map->root);
+	atomic_store(&map->size, 0);
+	CMAP_Publish(map, NULL, root, POLY_DEFAULT, POLY_DEFAULT, 0);
+	if(!map->garbage)
+	{
+		free(map->retiring);
+		map->retiring = NULL;
+		map->retiring_capacity = 0;
+	}
+	pthread_mutex_unlock(&map->lock);
+}
+
+CMAP_Reader *CMAP_Register(CMAP_Map *map, CMAP_Reader *reader)
+{
+	atomic_init(&reader->epoch, 0);
+	reader->nesting = 0;
+	reader->map = map;
+	pthread_mutex_lock(&map->lock);
+	reader->next = map->readers;
+	map->readers = reader;
+	pthread_mutex_unlock(&map->lock);
+	return reader;
+}
+
+void CMAP_Unregister(CMAP_Reader *reader)
+{
+	CMAP_Map *map = reader->map;
+	pthread_mutex_lock(&map->lock);
+	CMAP_Reader **link = &map->readers;
+	while(*link != reader) link = &(*link)->next;
+	*link = reader->next;
+	pthread_mutex_unlock(&map->lock);
+}
+
+void CMAP_Enter(CMAP_Reader *reader)
+{
+	if(reader->nesting++) return;
+	atomic_store(&reader->epoch, atomic_load(&reader->map->epoch));
+}
+
+void CMAP_Leave(CMAP_Reader *reader)
+{
+	if(--reader->nesting) return;
+	atomic_store(&reader->epoch, 0);
+}
+
+// helper function gets the node associated with a key, the reader must be entered
+// takes a pointer to the reader of the map to search and the key
+// returns a pointer to the node or NULL if not found
+CMAP_Node *CMAP_GetNode(CMAP_Reader *reader, POLY_Polymorphic key)
+{
+	CMAP_Map *map = reader->map;
+	CMAP_Node *current = atomic_load(&map->root);
+	int comparison;
+	while(current && (comparison = map->comparator(key, current->key)))
+	{
+		if(comparison > 0) current = current->right;
+		else current = current->left;
+	}
+	return current;
+}
+
+POLY_Polymorphic CMAP_Get(CMAP_Reader *reader, POLY_Polymorphic key)
+{
+	CMAP_Enter(reader);
+	CMAP_Node *node = CMAP_GetNode(reader, key);
+	POLY_Polymorphic value = node ? node->value : POLY_DEFAULT;
+	CMAP_Leave(reader);
+	return value;
+}
+
+int CMAP_Contains(CMAP_Reader *reader, POLY_Polymorphic key)
+{
+	CMAP_Enter(reader);
+	int contains = CMAP_GetNode(reader, key) ? 1 : 0;
+	CMAP_Leave(reader);
+	return contains;
+}
+
+// helper function gets the height of a subtree
+// takes a pointer to the root of the subtree, which may be NULL
+// returns the height
+int CMAP_Height(CMAP_Node *node)
+{
+	return node ? node->height : 0;
+}
+
+// helper function allocates a node, must be called by a writer
+// takes the key and value of the node and its children
+// returns a pointer to the node
+CMAP_Node *CMAP_CreateNode(POLY_Polymorphic key, POLY_Polymorphic value, CMAP_Node *left, CMAP_Node *right)
+{
+	CMAP_Node *node = malloc(sizeof(CMAP_Node));
+	node->left = left;
+	node->right = right;
+	int heightl = CMAP_Height(left);
+	int heightr = CMAP_Height(right);
+	node->height = (heightl > heightr ? heightl : heightr) + 1;
+	node->key = key;
+	node->value = value;
+	return node;
+}
+
+// helper function retires a node replaced by the write in progress, its key and value live on in its replacement
+// takes a pointer to the map and the node
+void CMAP_Retire(CMAP_Map *map, CMAP_Node *node)
+{
+	if(map->retiring_count == map->retiring_capacity)
+	{
+		map->retiring_capacity = map->retiring_capacity ? map->retiring_capacity*2 : 2*CMAP_DEPTH;
+		map->retiring = realloc(map->retiring, sizeof(CMAP_Node*)*map->retiring_capacity);
+	}
+	map->retiring[map->retiring_count++] = node;
+}
+
+// helper function allocates a node whose subtrees may differ in height by two, rotating to restore balance
+// any node taken apart by a rotation is retired
+// takes a pointer to the map, the key and value of the node and its children
+// returns a pointer to the root of the balanced subtree
+CMAP_Node *CMAP_Balance(CMAP_Map *map, POLY_Polymorphic key, POLY_Polymorphic value, CMAP_Node *left, CMAP_Node *right)
+{
+	int heightl = CMAP_Height(left);
+	int heightr = CMAP_Height(right);
+	if(heightl > heightr + 1)
+	{
+		CMAP_Retire(map, left);
+		if(CMAP_Height(left->left) >= CMAP_Height(left->right))
+			return CMAP_CreateNode(left->key, left->value, left->left, CMAP_CreateNode(key, value, left->right, right));
+		CMAP_Node *pivot = left->right;
+		CMAP_Retire(map, pivot);
+		return CMAP_CreateNode(pivot->key, pivot->value,
+			CMAP_CreateNode(left->key, left->value, left->left, pivot->left),
+			CMAP_CreateNode(key, value, pivot->right, right));
+	}
+	if(heightr > heightl + 1)
+	{
+		CMAP_Retire(map, right);
+		if(CMAP_Height(right->right) >= CMAP_Height(right->left))
+			return CMAP_CreateNode(right->key, right->value, CMAP_CreateNode(key, value, left, right->left), right->right);
+		CMAP_Node *pivot = right->left;
+		CMAP_Retire(map, pivot);
+		return CMAP_CreateNode(pivot->key, pivot->value,
+			CMAP_CreateNode(key, value, left, pivot->left),
+			CMAP_CreateNode(right->key, right->value, pivot->right, right->right));
+	}
+	return CMAP_CreateNode(key, value, left, right);
+}
+
+// helper function copies the path to a key, setting its value
+// takes a pointer to the map, the root of the subtree, the key and value, and a pointer to the value replaced,
+// which is set to the replaced value and whose drop bits are set to DROPVALUE if a value was replaced
+// returns the root of the new subtree
+CMAP_Node *CMAP_SetNode(CMAP_Map *map, CMAP_Node *node, POLY_Polymorphic key, POLY_Polymorphic value, POLY_Polymorphic *replaced, int *drop)
+{
+	if(!node)
+	{
+		atomic_fetch_add(&map->size, 1);
+		return CMAP_CreateNode(key, value, NULL, NULL);
+	}
+	CMAP_Retire(map, node);
+	int comparison = map->comparator(key, node->key);
+	if(comparison < 0) return CMAP_Balance(map, node->key, node->value, CMAP_SetNode(map, node->left, key, value, replaced, drop), node->right);
+	if(comparison > 0) return CMAP_Balance(map, node->key, node->value, node->left, CMAP_SetNode(map, node->right, key, value, replaced, drop));
+	*replaced = node->value;
+	*drop = DROPVALUE;
+	return CMAP_CreateNode(node->key, value, node->left, node->right);
+}
+
+// helper function copies the path to the least key of a subtree, removing it
+// takes a pointer to the map, the root of the subtree, and a pointer to be set to the node removed
+// returns the root of the new subtree
+CMAP_Node *CMAP_RemoveLeast(CMAP_Map *map, CMAP_Node *node, CMAP_Node **least)
+{
+	CMAP_Retire(map, node);
+	if(!node->left)
+	{
+		*least = node;
+		return node->right;
+	}
+	return CMAP_Balance(map, node->key, node->value, CMAP_RemoveLeast(map, node->left, least), node->right);
+}
+
+// helper function copies the path to a key which is in a subtree, removing it
+// takes a pointer to the map, the root of the subtree, and the key
+// returns the root of the new subtree
+CMAP_Node *CMAP_DeleteNode(CMAP_Map *map, CMAP_Node *node, POLY_Polymorphic key)
+{
+	CMAP_Retire(map, node);
+	int comparison = map->comparator(key, node->key);
+	if(comparison < 0) return CMAP_Balance(map, node->key, node->value, CMAP_DeleteNode(map, node->left, key), node->right);
+	if(comparison > 0) return CMAP_Balance(map, node->key, node->value, node->left, CMAP_DeleteNode(map, node->right, key));
+	if(!node->left) return node->right;
+	if(!node->right) return node->left;
+	CMAP_Node *least;
+	CMAP_Node *right = CMAP_RemoveLeast(map, node->right, &least);
+	return CMAP_Balance(map, least->key, least->value, node->left, right);
+}
+
+void CMAP_Set(CMAP_Map *map, POLY_Polymorphic key, POLY_Polymorphic value)
+{
+	pthread_mutex_lock(&map->lock);
+	POLY_Polymorphic replaced = POLY_DEFAULT;
+	int drop = 0;
+	CMAP_Node *root = CMAP_SetNode(map, atomic_load(&map->root), key, value, &replaced, &drop);
+	CMAP_Publish(map, root, NULL, POLY_DEFAULT, replaced, drop);
+	pthread_mutex_unlock(&map->lock);
+}
+
+void CMAP_Insert(CMAP_Map *map, POLY_Polymorphic key)
+{
+	CMAP_Set(map, key, POLY_DEFAULT);
+}
+
+void CMAP_Delete(CMAP_Map *map, POLY_Polymorphic key)
+{
+	pthread_mutex_lock(&map->lock);
+	CMAP_Node *current = atomic_load(&map->root);
+	int comparison;
+	while(current && (comparison = map->comparator(key, current->key)))
+	{
+		if(comparison > 0) current = current->right;
+		else current = current->left;
+	}
+	if(current)
+	{
+		POLY_Polymorphic deleted = current->key;
+		POLY_Polymorphic value = current->value;
+		CMAP_Node *root = CMAP_DeleteNode(map, atomic_load(&map->root), key);
+		atomic_fetch_sub(&map->size, 1);
+		CMAP_Publish(map, root, NULL, deleted, value, DROPKEY | DROPVALUE);
+	}
+	pthread_mutex_unlock(&map->lock);
+}
+
+unsigned long CMAP_Size(CMAP_Map *map)
+{
+	return atomic_load(&map->size);
+}
+
+CMAP_Iterator *CMAP_InitializeIterator(CMAP_Reader *reader, CMAP_Iterator *iterator)
+{
+	iterator->root = atomic_load(&reader->map->root);
+	iterator->depth = -1;
+	return iterator;
+}
+
+// helper function pushes a node and its chain of left children onto the path of an iterator
+// takes a pointer to the iterator and the node, which may be NULL
+void CMAP_Descend(CMAP_Iterator *iterator, CMAP_Node *node)
+{
+	while(node)
+	{
+		iterator->nodes[++iterator->depth] = node;
+		node = node->left;
+	}
+}
+
+int CMAP_Next(CMAP_Iterator *iterator)
+{
+	// the path is empty both before the first element and after the last, so iterating again starts over
+	if(iterator->depth < 0) CMAP_Descend(iterator, iterator->root);
+	else CMAP_Descend(iterator, iterator->nodes[iterator->depth--]->right);
+	return iterator->depth >= 0;
+}
+
+POLY_Polymorphic CMAP_Key(CMAP_Iterator *iterator)
+{
+	if(iterator->depth >= 0) return iterator->nodes[iterator->depth]->key;
+	else return POLY_DEFAULT;
+}
+
+POLY_Polymorphic CMAP_Value(CMAP_Iterator *iterator)
+{
+	if(iterator->depth >= 0) return iterator->nodes[iterator->depth]->value;
+	else return POLY_DEFAULT;
+}
+
+void CMAP_Reset(CMAP_Iterator *iterator)
+{
+	iterator->depth = -1;
+}
+
+void CMAP_Destroy(POLY_Polymorphic item)
+{
+	CMAP_Clear(CMAP_POLYMAP(item));
+	pthread_mutex_destroy(&CMAP_POLYMAP(item)->lock);
+	free(CMAP_POLYMAP(item));
+}
@@ -0,0 +1,176 @@
+/*
+Header file for concurrent read-mostly tree map implementation
+
+Copyright (C) 2016 Kyle Gagner
+All Rights Reserved
+*/
+
+// for threads
+#include <pthread.h>
+// for atomics
+#include <stdatomic.h>
+// for polymorphism
+#include "poly.h"
+// for comparator and destroyer types
+#include "avl.h"
+
+// include guard
+#ifndef CMAP_H
+#define CMAP_H
+
+// maximum height of a tree, enough for any number of keys that fits in memory
+#define CMAP_DEPTH 96
+
+// alignment of readers, the size of a cache line, so readers on different threads do not share lines
+#define CMAP_ALIGNMENT 64
+
+// casting polymorphism
+#define CMAP_POLYMAP(value) ((CMAP_Map*)value.ref)
+
+// represents a node in a concurrent map, nodes are never modified once published
+// a write copies the path from the root to the nodes it changes, so readers always see a consistent tree
+typedef struct CMAP_Node
+{
+	struct CMAP_Node *left;
+	struct CMAP_Node *right;
+	int height;
+	POLY_Polymorphic key;
+	POLY_Polymorphic value;
+} CMAP_Node;
+
+// represents memory retired by a write, freed once no reader can still be looking at it
+typedef struct CMAP_Garbage
+{
+	struct CMAP_Garbage *next;
+	unsigned long epoch;
+	CMAP_Node *tree;
+	POLY_Polymorphic key;
+	POLY_Polymorphic value;
+	int drop;
+	unsigned long nodes_count;
+	CMAP_Node *nodes[];
+} CMAP_Garbage;
+
+// represents a thread reading from a concurrent map
+// epoch is the epoch of the map when the reader entered, or 0 when the reader is outside
+typedef struct CMAP_Reader
+{
+	_Alignas(CMAP_ALIGNMENT) _Atomic unsigned long epoch;
+	unsigned int nesting;
+	struct CMAP_Map *map;
+	struct CMAP_Reader *next;
+} CMAP_Reader;
+
+// represents a concurrent map
+// readers never wait, writers are serialized by a lock, and memory replaced by a write is reclaimed
+// once every reader has left the epoch in which it was replaced
+typedef struct CMAP_Map
+{
+	_Atomic(CMAP_Node*) root;
+	_Atomic unsigned long size;
+	_Atomic unsigned long epoch;
+	pthread_mutex_t lock;
+	CMAP_Reader *readers;
+	CMAP_Garbage *garbage;
+	CMAP_Node **retiring;
+	unsigned long retiring_count;
+	unsigned long retiring_capacity;
+	AVL_Comparator comparator;
+	AVL_Destroyer kfree;
+	AVL_Destroyer vfree;
+} CMAP_Map;
+
+// represents an inorder iterator over the version of a map seen when the iterator was initialized
+// the iterator keeps the path from the root to the current key
+typedef struct CMAP_Iterator
+{
+	CMAP_Node *root;
+	CMAP_Node *nodes[CMAP_DEPTH];
+	int depth;
+} CMAP_Iterator;
+
+// initialize a map
+// takes a pointer to the memory to initialize, the functions used to destroy keys, destroy values, and compare keys
+// kfree and vfree may be NULL
+// returns a pointer to the map
+CMAP_Map *CMAP_Initialize(CMAP_Map *map, AVL_Destroyer kfree, AVL_Destroyer vfree, AVL_Comparator comparator);
+
+// remove all items from a map and free associated memory, memory still visible to readers is freed once they leave
+// takes a pointer to the map
+void CMAP_Clear(CMAP_Map *map);
+
+// registers a reader with a map, each thread reading from the map needs its own reader
+// takes a pointer to the map and the memory to initialize
+// returns a pointer to the reader
+CMAP_Reader *CMAP_Register(CMAP_Map *map, CMAP_Reader *reader);
+
+// unregisters a reader from its map, the reader must be outside
+// takes a pointer to the reader
+void CMAP_Unregister(CMAP_Reader *reader);
+
+// enters a reader, keys and values read from the map remain valid until the reader leaves
+// entering may be nested, the reader leaves when it has left as many times as it entered
+// takes a pointer to the reader
+void CMAP_Enter(CMAP_Reader *reader);
+
+// leaves a reader
+// takes a pointer to the reader
+void CMAP_Leave(CMAP_Reader *reader);
+
+// get the value associated with a key, never waits for writers
+// if the map destroys its values, the reader should be entered for as long as the value is used
+// takes a pointer to the reader of the map to search and the key
+// returns the value or POLY_DEFAULT if not found
+POLY_Polymorphic CMAP_Get(CMAP_Reader *reader, POLY_Polymorphic key);
+
+// determines whether a map contains a key, never waits for writers
+// takes a pointer to the reader of the map to search and the key
+// returns 1 if the map contains the key, returns 0 otherwise
+int CMAP_Contains(CMAP_Reader *reader, POLY_Polymorphic key);
+
+// set the value associated with a key
+// takes a pointer to the map and the key and value
+void CMAP_Set(CMAP_Map *map, POLY_Polymorphic key, POLY_Polymorphic value);
+
+// insert a key into a map with no associated value
+// takes a pointer to the map and the key
+void CMAP_Insert(CMAP_Map *map, POLY_Polymorphic key);
+
+// delete a key from a map
+// takes a pointer to the map and the key
+void CMAP_Delete(CMAP_Map *map, POLY_Polymorphic key);
+
+// gets the size of a map
+// takes a pointer to the map
+// returns the number of items in the map
+unsigned long CMAP_Size(CMAP_Map *map);
+
+// initializes an iterator for a map, the reader must be entered for as long as the iterator is used
+// takes a pointer to the reader of the map to iterate over and the memory to initialize
+// returns an iterator for the current version of the map
+CMAP_Iterator *CMAP_InitializeIterator(CMAP_Reader *reader, CMAP_Iterator *iterator);
+
+// gets the next element from an iterator
+// takes a pointer to the iterator
+// returns 0 if the end has been reached, 1 otherwise
+int CMAP_Next(CMAP_Iterator *iterator);
+
+// gets the key of the current element of an iterator
+// takes a pointer to the iterator
+// returns the key
+POLY_Polymorphic CMAP_Key(CMAP_Iterator *iterator);
+
+// gets the value of the current element of an iterator
+// takes a pointer to the iterator
+// returns the value
+POLY_Polymorphic CMAP_Value(CMAP_Iterator *iterator);
+
+// resets an iterator to the beginning
+// takes a pointer to the iterator
+void CMAP_Reset(CMAP_Iterator *iterator);
+
+// a function to clear a map and free the pointer to the map, no reader may be registered
+// takes a pointer to the map to destroy
+void CMAP_Destroy(POLY_Polymorphic item);
+
+#endif
@@ -0,0 +1,378 @@
+/*
+Source file for compact AVL tree set implementation
+
+Copyright (C) 2016 Kyle Gagner
+All Rights Reserved
+*/
+
+#include <stdlib.h>
+#include "cset.h"
+
+// bits of a left field holding the index of the child
+#define INDEX 0x3FFFFFFFu
+
+// first bit of a left field holding the balance factor
+#define SHIFT 30
+
+// fields of a node by index
+#define NODE(set, index)  ((set)->nodes[index])
+#define LEFT(set, index)  (NODE(set, index).left & INDEX)
+#define RIGHT(set, index) (NODE(set, index).right)
+#define BAL(set, index)   ((int)(NODE(set, index).left >> SHIFT) - 1)
+
+// smallest number of nodes allocated at once, including the unused node 0
+#define MINIMUM 16
+
+// helper function sets the left child of a node, keeping its balance factor
+void CSET_SetLeft(CSET_Set *set, unsigned int node, unsigned int left)
+{
+	NODE(set, node).left = (NODE(set, node).left & ~INDEX) | left;
+}
+
+// helper function sets the balance factor of a node, keeping its left child
+void CSET_SetBalance(CSET_Set *set, unsigned int node, int balance)
+{
+	NODE(set, node).left = (NODE(set, node).left & INDEX) | ((unsigned int)(balance + 1) << SHIFT);
+}
+
+CSET_Set *CSET_Initialize(CSET_Set *set, AVL_Destroyer kfree, AVL_Comparator comparator)
+{
+	set->nodes = NULL;
+	set->root = 0;
+	set->free = 0;
+	set->used = 0;
+	set->capacity = 0;
+	set->size = 0;
+	set->comparator = comparator;
+	set->kfree = kfree;
+	return set;
+}
+
+void CSET_Clear(CSET_Set *set)
+{
+	if(set->kfree)
+	{
+		CSET_Iterator iterator;
+		CSET_InitializeIterator(set, &iterator);
+		while(CSET_Next(&iterator)) set->kfree(CSET_Key(&iterator));
+	}
+	free(set->nodes);
+	CSET_Initialize(set, set->kfree, set->comparator);
+}
+
+// helper function takes a node from the free list, or from the end of the slab, growing it if needed
+// takes a pointer to the set and the key of the node
+// returns the index of the node, which is balanced and has no children
+unsigned int CSET_CreateNode(CSET_Set *set, POLY_Polymorphic key)
+{
+	unsigned int node = set->free;
+	if(node) set->free = LEFT(set, node);
+	else
+	{
+		// node 0 stands for no node, so the slab starts from 1
+		if(!set->used) set->used = 1;
+		if(set->used >= set->capacity)
+		{
+			set->capacity = set->capacity ? set->capacity*2 : MINIMUM;
+			set->nodes = realloc(set->nodes, sizeof(CSET_Node)*set->capacity);
+		}
+		node = set->used++;
+	}
+	NODE(set, node).key = key;
+	NODE(set, node).left = 1u << SHIFT;
+	NODE(set, node).right = 0;
+	return node;
+}
+
+// helper function returns a node to the free list
+// takes a pointer to the set and the index of the node
+void CSET_DestroyNode(CSET_Set *set, unsigned int node)
+{
+	NODE(set, node).left = set->free;
+	set->free = node;
+}
+
+// helper function rotates a subtree whose left side is two higher than its right, updating balance factors
+// takes a pointer to the set and the root of the subtree
+// returns the new root of the subtree
+unsigned int CSET_RotateRight(CSET_Set *set, unsigned int node)
+{
+	unsigned int left = LEFT(set, node);
+	if(BAL(set, left) <= 0)
+	{
+		int balance = BAL(set, left);
+		CSET_SetLeft(set, node, RIGHT(set, left));
+		RIGHT(set, left) = node;
+		CSET_SetBalance(set, node, balance ? 0 : -1);
+		CSET_SetBalance(set, left, balance ? 0 : 1);
+		return left;
+	}
+	unsigned int pivot = RIGHT(set, left);
+	int balance = BAL(set, pivot);
+	RIGHT(set, left) = LEFT(set, pivot);
+	CSET_SetLeft(set, node, RIGHT(set, pivot));
+	CSET_SetLeft(set, pivot, left);
+	RIGHT(set, pivot) = node;
+	CSET_SetBalance(set, left, balance == 1 ? -1 : 0);
+	CSET_SetBalance(set, node, balance == -1 ? 1 : 0);
+	CSET_SetBalance(set, pivot, 0);
+	return pivot;
+}
+
+// helper function rotates a subtree whose right side is two higher than its left, updating balance factors
+// takes a pointer to the set and the root of the subtree
+// returns the new root of the subtree
+unsigned int CSET_RotateLeft(CSET_Set *set, unsigned int node)
+{
+	unsigned int right = RIGHT(set, node);
+	if(BAL(set, right) >= 0)
+	{
+		int balance = BAL(set, right);
+		RIGHT(set, node) = LEFT(set, right);
+		CSET_SetLeft(set, right, node);
+		CSET_SetBalance(set, node, balance ? 0 : 1);
+		CSET_SetBalance(set, right, balance ? 0 : -1);
+		return right;
+	}
+	unsigned int pivot = LEFT(set, right);
+	int balance = BAL(set, pivot);
+	CSET_SetLeft(set, right, RIGHT(set, pivot));
+	RIGHT(set, node) = LEFT(set, pivot);
+	RIGHT(set, pivot) = right;
+	CSET_SetLeft(set, pivot, node);
+	CSET_SetBalance(set, right, balance == -1 ? 1 : 0);
+	CSET_SetBalance(set, node, balance == 1 ? -1 : 0);
+	CSET_SetBalance(set, pivot, 0);
+	return pivot;
+}
+
+// helper function inserts a key into a subtree
+// takes a pointer to the set, the root of the subtree, the key, and a pointer to a flag set if the subtree grew higher
+// returns the new root of the subtree
+unsigned int CSET_InsertNode(CSET_Set *set, unsigned int node, POLY_Polymorphic key, int *grew)
+{
+	if(!node)
+	{
+		set->size++;
+		*grew = 1;
+		return CSET_CreateNode(set, key);
+	}
+	int comparison = set->comparator(key, NODE(set, node).key);
+	if(!comparison)
+	{
+		*grew = 0;
+		return node;
+	}
+	if(comparison < 0)
+	{
+		unsigned int left = CSET_InsertNode(set, LEFT(set, node), key, grew);
+		CSET_SetLeft(set, node, left);
+		if(!*grew) return node;
+		int balance = BAL(set, node) - 1;
+		if(balance == -2)
+		{
+			*grew = 0;
+			return CSET_RotateRight(set, node);
+		}
+		CSET_SetBalance(set, node, balance);
+		*grew = balance != 0;
+	}
+	else
+	{
+		unsigned int right = CSET_InsertNode(set, RIGHT(set, node), key, grew);
+		RIGHT(set, node) = right;
+		if(!*grew) return node;
+		int balance = BAL(set, node) + 1;
+		if(balance == 2)
+		{
+			*grew = 0;
+			return CSET_RotateLeft(set, node);
+		}
+		CSET_SetBalance(set, node, balance);
+		*grew = balance != 0;
+	}
+	return node;
+}
+
+void CSET_Insert(CSET_Set *set, POLY_Polymorphic key)
+{
+	int grew;
+	set->root = CSET_InsertNode(set, set->root, key, &grew);
+}
+
+// helper function rebalances a subtree whose left side became lower
+// takes a pointer to the set, the root of the subtree, and a pointer to a flag set if the subtree became lower
+// returns the new root of the subtree
+unsigned int CSET_LeftShrunk(CSET_Set *set, unsigned int node, int *shrunk)
+{
+	int balance = BAL(set, node) + 1;
+	if(balance == 2)
+	{
+		node = CSET_RotateLeft(set, node);
+		*shrunk = BAL(set, node) == 0;
+		return node;
+	}
+	CSET_SetBalance(set, node, balance);
+	*shrunk = balance == 0;
+	return node;
+}
+
+// helper function rebalances a subtree whose right side became lower
+// takes a pointer to the set, the root of the subtree, and a pointer to a flag set if the subtree became lower
+// returns the new root of the subtree
+unsigned int CSET_RightShrunk(CSET_Set *set, unsigned int node, int *shrunk)
+{
+	int balance = BAL(set, node) - 1;
+	if(balance == -2)
+	{
+		node = CSET_RotateRight(set, node);
+		*shrunk = BAL(set, node) == 0;
+		return node;
+	}
+	CSET_SetBalance(set, node, balance);
+	*shrunk = balance == 0;
+	return node;
+}
+
+// helper function detaches the node with the least key of a subtree
+// takes a pointer to the set, the root of the subtree, a pointer to be set to the node detached,
+// and a pointer to a flag set if the subtree became lower
+// returns the new root of the subtree
+unsigned int CSET_RemoveLeast(CSET_Set *set, unsigned int node, unsigned int *least, int *shrunk)
+{
+	if(!LEFT(set, node))
+	{
+		*least = node;
+		*shrunk = 1;
+		return RIGHT(set, node);
+	}
+	CSET_SetLeft(set, node, CSET_RemoveLeast(set, LEFT(set, node), least, shrunk));
+	if(*shrunk) node = CSET_LeftShrunk(set, node, shrunk);
+	return node;
+}
+
+// helper function deletes a key from a subtree
+// takes a pointer to the set, the root of the subtree, the key, and a pointer to a flag set if the subtree became lower
+// returns the new root of the subtree
+unsigned int CSET_DeleteNode(CSET_Set *set, unsigned int node, POLY_Polymorphic key, int *shrunk)
+{
+	if(!node)
+	{
+		*shrunk = 0;
+		return node;
+	}
+	int comparison = set->comparator(key, NODE(set, node).key);
+	if(comparison < 0)
+	{
+		CSET_SetLeft(set, node, CSET_DeleteNode(set, LEFT(set, node), key, shrunk));
+		if(*shrunk) node = CSET_LeftShrunk(set, node, shrunk);
+		return node;
+	}
+	if(comparison > 0)
+	{
+		RIGHT(set, node) = CSET_DeleteNode(set, RIGHT(set, node), key, shrunk);
+		if(*shrunk) node = CSET_RightShrunk(set, node, shrunk);
+		return node;
+	}
+	set->size--;
+	if(set->kfree) set->kfree(NODE(set, node).key);
+	unsigned int left = LEFT(set, node);
+	unsigned int right = RIGHT(set, node);
+	if(!left || !right)
+	{
+		CSET_DestroyNode(set, node);
+		*shrunk = 1;
+		return left ? left : right;
+	}
+	unsigned int least;
+	RIGHT(set, node) = CSET_RemoveLeast(set, right, &least, shrunk);
+	NODE(set, node).key = NODE(set, least).key;
+	CSET_DestroyNode(set, least);
+	if(*shrunk) node = CSET_RightShrunk(set, node, shrunk);
+	return node;
+}
+
+void CSET_Delete(CSET_Set *set, POLY_Polymorphic key)
+{
+	int shrunk;
+	set->root = CSET_DeleteNode(set, set->root, key, &shrunk);
+}
+
+int CSET_Contains(CSET_Set *set, POLY_Polymorphic key)
+{
+	unsigned int current = set->root;
+	while(current)
+	{
+		int comparison = set->comparator(key, NODE(set, current).key);
+		if(!comparison) return 1;
+		current = comparison > 0 ? RIGHT(set, current) : LEFT(set, current);
+	}
+	return 0;
+}
+
+unsigned long CSET_Size(CSET_Set *set)
+{
+	return set->size;
+}
+
+unsigned long CSET_Memory(CSET_Set *set)
+{
+	return sizeof(CSET_Node)*set->capacity;
+}
+
+CSET_Iterator *CSET_InitializeIterator(CSET_Set *set, CSET_Iterator *iterator)
+{
+	iterator->set = set;
+	iterator->depth = -1;
+	return iterator;
+}
+
+// helper function pushes a node and its chain of left children onto the path of an iterator
+// takes a pointer to the iterator and the index of the node, which may be 0
+void CSET_Descend(CSET_Iterator *iterator, unsigned int node)
+{
+	while(node)
+	{
+		iterator->nodes[++iterator->depth] = node;
+		node = LEFT(iterator->set, node);
+	}
+}
+
+int CSET_Next(CSET_Iterator *iterator)
+{
+	// the path is empty both before the first key and after the last, so iterating again starts over
+	if(iterator->depth < 0) CSET_Descend(iterator, iterator->set->root);
+	else CSET_Descend(iterator, RIGHT(iterator->set, iterator->nodes[iterator->depth--]));
+	return iterator->depth >= 0;
+}
+
+POLY_Polymorphic CSET_Key(CSET_Iterator *iterator)
+{
+	if(iterator->depth >= 0) return NODE(iterator->set, iterator->nodes[iterator->depth]).key;
+	else return POLY_DEFAULT;
+}
+
+void CSET_Reset(CSET_Iterator *iterator)
+{
+	iterator->depth = -1;
+}
+
+int CSET_DeepComparator(POLY_Polymorphic key1, POLY_Polymorphic key2)
+{
+	if (CSET_POLYSET(key1)->size < CSET_POLYSET(key2)->size) return -1;
+	else if (CSET_POLYSET(key1)->size > CSET_POLYSET(key2)->size) return 1;
+	CSET_Iterator iter1;
+	CSET_InitializeIterator(CSET_POLYSET(key1), &iter1);
+	CSET_Iterator iter2;
+	CSET_InitializeIterator(CSET_POLYSET(key2), &iter2);
+	int cmp = 0;
+	while(CSET_Next(&iter1) && CSET_Next(&iter2))
+		if((cmp = CSET_POLYSET(key1)->comparator(CSET_Key(&iter1), CSET_Key(&iter2))) != 0) break;
+	return cmp;
+}
+
+void CSET_Destroy(POLY_Polymorphic item)
+{
+	CSET_Clear(CSET_POLYSET(item));
+	free(CSET_POLYSET(item));
+}
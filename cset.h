@@ -0,0 +1,118 @@
+/*
+Header file for compact AVL tree set implementation
+
+Copyright (C) 2016 Kyle Gagner
+All Rights Reserved
+*/
+
+// for polymorphism
+#include "poly.h"
+// for comparator and destroyer types
+#include "avl.h"
+
+// include guard
+#ifndef CSET_H
+#define CSET_H
+
+// maximum height of a set, enough for the largest number of nodes an index can address
+#define CSET_DEPTH 48
+
+// casting polymorphism
+#define CSET_POLYSET(value) ((CSET_Set*)value.ref)
+
+// represents a node in a compact set, 16 bytes against the 56 of an AVL_Node
+// children are 30 bit indices into the slab of the set, 0 meaning no child,
+// and the top 2 bits of left hold the balance factor (right height - left height) plus one
+typedef struct CSET_Node
+{
+	POLY_Polymorphic key;
+	unsigned int left;
+	unsigned int right;
+} CSET_Node;
+
+// represents a compact set, an AVL tree of keys without values whose nodes live in one growable slab
+// freed nodes are linked through their left indices for reuse
+typedef struct CSET_Set
+{
+	CSET_Node *nodes;
+	unsigned int root;
+	unsigned int free;
+	unsigned int used;
+	unsigned int capacity;
+	unsigned long size;
+	AVL_Comparator comparator;
+	AVL_Destroyer kfree;
+} CSET_Set;
+
+// represents an inorder iterator for a compact set
+// the iterator keeps the path from the root to the current key
+typedef struct CSET_Iterator
+{
+	CSET_Set *set;
+	unsigned int nodes[CSET_DEPTH];
+	int depth;
+} CSET_Iterator;
+
+// initialize a set
+// takes a pointer to the memory to initialize, the functions used to destroy keys and compare keys
+// kfree may be NULL
+// returns a pointer to the set
+CSET_Set *CSET_Initialize(CSET_Set *set, AVL_Destroyer kfree, AVL_Comparator comparator);
+
+// remove all keys from a set and free associated memory
+// takes a pointer to the set
+void CSET_Clear(CSET_Set *set);
+
+// insert a key into a set, a key already in the set is kept and the new key is not taken
+// takes a pointer to the set and the key
+void CSET_Insert(CSET_Set *set, POLY_Polymorphic key);
+
+// delete a key from a set
+// takes a pointer to the set and the key
+void CSET_Delete(CSET_Set *set, POLY_Polymorphic key);
+
+// determines whether a set contains a key
+// takes a pointer to the set to search and the key
+// returns 1 if the set contains the key, returns 0 otherwise
+int CSET_Contains(CSET_Set *set, POLY_Polymorphic key);
+
+// gets the size of a set
+// takes a pointer to the set
+// returns the number of keys in the set
+unsigned long CSET_Size(CSET_Set *set);
+
+// gets the memory used by a set
+// takes a pointer to the set
+// returns the number of bytes allocated for nodes
+unsigned long CSET_Memory(CSET_Set *set);
+
+// initializes an iterator for a set
+// takes a pointer to the set to iterate over and the memory to initialize
+// returns an iterator for that set
+CSET_Iterator *CSET_InitializeIterator(CSET_Set *set, CSET_Iterator *iterator);
+
+// gets the next key from an iterator
+// takes a pointer to the iterator
+// returns 0 if the end has been reached, 1 otherwise
+int CSET_Next(CSET_Iterator *iterator);
+
+// gets the current key of an iterator
+// takes a pointer to the iterator
+// returns the key
+POLY_Polymorphic CSET_Key(CSET_Iterator *iterator);
+
+// resets an iterator to the beginning
+// takes a pointer to the iterator
+void CSET_Reset(CSET_Iterator *iterator);
+
+// a function to do a deep comparison of two sets
+// the key comparator for the first set will be used to compare keys between the sets
+// takes pointers to the two sets to compare
+// returns the result of the comparison
+int CSET_DeepComparator(POLY_Polymorphic key1, POLY_Polymorphic key2);
+
+// a function to clear a set and free the pointer to the set
+// takes a pointer to the set to destroy
+void CSET_Destroy(POLY_Polymorphic item);
+
+#endif
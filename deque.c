@@ -0,0 +1,125 @@
+/*
+Source file for ring buffer deque implementation
+
+Copyright (C) 2016 Kyle Gagner
+All Rights Reserved
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "deque.h"
+
+// smallest capacity of a deque which holds anything
+#define MINIMUM 16
+
+// position in the buffer of a value, counting from the head
+#define SLOT(deque, position) (((deque)->head + (position)) & ((deque)->capacity - 1))
+
+DEQUE_Deque* DEQUE_Initialize(DEQUE_Deque* deque)
+{
+	deque->values = NULL;
+	deque->capacity = 0;
+	deque->head = 0;
+	deque->size = 0;
+	return deque;
+}
+
+void DEQUE_Clear(DEQUE_Deque* deque)
+{
+	free(deque->values);
+	DEQUE_Initialize(deque);
+}
+
+// helper function doubles the capacity of a deque, moving its values to the start of a new buffer
+// takes a pointer to the deque
+void DEQUE_Grow(DEQUE_Deque* deque)
+{
+	unsigned long capacity = deque->capacity ? deque->capacity*2 : MINIMUM;
+	POLY_Polymorphic* values = malloc(sizeof(POLY_Polymorphic)*capacity);
+	// the values may wrap around the end of the old buffer, in which case they are copied in two pieces
+	unsigned long first = deque->capacity - deque->head < deque->size ? deque->capacity - deque->head : deque->size;
+	if(deque->size)
+	{
+		memcpy(values, deque->values + deque->head, sizeof(POLY_Polymorphic)*first);
+		memcpy(values + first, deque->values, sizeof(POLY_Polymorphic)*(deque->size - first));
+	}
+	free(deque->values);
+	deque->values = values;
+	deque->capacity = capacity;
+	deque->head = 0;
+}
+
+void DEQUE_InsertHead(DEQUE_Deque* deque, POLY_Polymorphic value)
+{
+	if(deque->size == deque->capacity) DEQUE_Grow(deque);
+	deque->head = (deque->head - 1) & (deque->capacity - 1);
+	deque->values[deque->head] = value;
+	deque->size++;
+}
+
+void DEQUE_InsertTail(DEQUE_Deque* deque, POLY_Polymorphic value)
+{
+	if(deque->size == deque->capacity) DEQUE_Grow(deque);
+	deque->values[SLOT(deque, deque->size)] = value;
+	deque->size++;
+}
+
+POLY_Polymorphic DEQUE_TakeHead(DEQUE_Deque* deque)
+{
+	if(!deque->size) return POLY_DEFAULT;
+	POLY_Polymorphic value = deque->values[deque->head];
+	deque->head = SLOT(deque, 1);
+	deque->size--;
+	return value;
+}
+
+POLY_Polymorphic DEQUE_TakeTail(DEQUE_Deque* deque)
+{
+	if(!deque->size) return POLY_DEFAULT;
+	deque->size--;
+	return deque->values[SLOT(deque, deque->size)];
+}
+
+POLY_Polymorphic DEQUE_PeekHead(DEQUE_Deque* deque)
+{
+	if(!deque->size) return POLY_DEFAULT;
+	return deque->values[deque->head];
+}
+
+POLY_Polymorphic DEQUE_PeekTail(DEQUE_Deque* deque)
+{
+	if(!deque->size) return POLY_DEFAULT;
+	return deque->values[SLOT(deque, deque->size - 1)];
+}
+
+unsigned long DEQUE_Size(DEQUE_Deque* deque)
+{
+	return deque->size;
+}
+
+DEQUE_Iterator* DEQUE_InitializeIterator(DEQUE_Deque* deque, DEQUE_Iterator* iterator)
+{
+	iterator->deque = deque;
+	iterator->position = -1;
+	return iterator;
+}
+
+int DEQUE_Next(DEQUE_Iterator* iterator)
+{
+	// one before the head wraps around to the head
+	iterator->position++;
+	if(iterator->position < iterator->deque->size) return 1;
+	iterator->position = -1;
+	return 0;
+}
+
+POLY_Polymorphic DEQUE_Peek(DEQUE_Iterator* iterator)
+{
+	if(iterator->position < iterator->deque->size) return iterator->deque->values[SLOT(iterator->deque, iterator->position)];
+	else return POLY_DEFAULT;
+}
+
+void DEQUE_Reset(DEQUE_Iterator* iterator)
+{
+	iterator->position = -1;
+}
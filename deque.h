@@ -0,0 +1,98 @@
+/*
+Header file for ring buffer deque implementation
+
+Copyright (C) 2016 Kyle Gagner
+All Rights Reserved
+*/
+
+#include "poly.h"
+
+// include guard
+#ifndef DEQUE_H
+#define DEQUE_H
+
+// a definition for NULL may be needed
+#ifndef NULL
+#define NULL ((void*)0)
+#endif
+
+// represents a deque, values are kept contiguously in a ring buffer whose capacity is a power of two
+// head is the position in the buffer of the value at the head
+typedef struct DEQUE_Deque
+{
+	POLY_Polymorphic* values;
+	unsigned long capacity;
+	unsigned long head;
+	unsigned long size;
+} DEQUE_Deque;
+
+// represents an iterator for a deque, from head to tail
+// position counts from the head, and is one before the head when the iterator is reset
+typedef struct DEQUE_Iterator
+{
+	DEQUE_Deque* deque;
+	unsigned long position;
+} DEQUE_Iterator;
+
+// initialize a deque
+// takes a pointer to the deque to initialize
+// returns a pointer to the deque
+DEQUE_Deque* DEQUE_Initialize(DEQUE_Deque* deque);
+
+// remove all items from a deque and free memory
+// takes a pointer to the deque
+void DEQUE_Clear(DEQUE_Deque* deque);
+
+// insert at the head of a deque
+// takes a pointer to the deque and the value to insert
+void DEQUE_InsertHead(DEQUE_Deque* deque, POLY_Polymorphic value);
+
+// insert at the tail of a deque
+// takes a pointer to the deque and the value to insert
+void DEQUE_InsertTail(DEQUE_Deque* deque, POLY_Polymorphic value);
+
+// take a value from the head of a deque
+// takes a pointer to the deque
+// returns the value removed or POLY_DEFAULT if the deque is empty
+POLY_Polymorphic DEQUE_TakeHead(DEQUE_Deque* deque);
+
+// take a value from the tail of a deque
+// takes a pointer to the deque
+// returns the value removed or POLY_DEFAULT if the deque is empty
+POLY_Polymorphic DEQUE_TakeTail(DEQUE_Deque* deque);
+
+// get a value from the head of a deque without removing it
+// takes a pointer to the deque
+// returns the value or POLY_DEFAULT if the deque is empty
+POLY_Polymorphic DEQUE_PeekHead(DEQUE_Deque* deque);
+
+// get a value from the tail of a deque without removing it
+// takes a pointer to the deque
+// returns the value or POLY_DEFAULT if the deque is empty
+POLY_Polymorphic DEQUE_PeekTail(DEQUE_Deque* deque);
+
+// finds the size of a deque
+// takes a pointer to the deque
+// returns the number of elements in the deque
+unsigned long DEQUE_Size(DEQUE_Deque* deque);
+
+// initialize an iterator for a deque
+// takes a pointer to the deque upon which to iterate and a pointer to the iterator to initialize
+// returns a pointer to the iterator
+DEQUE_Iterator* DEQUE_InitializeIterator(DEQUE_Deque* deque, DEQUE_Iterator* iterator);
+
+// gets the next element from an iterator
+// takes a pointer to the iterator
+// returns 0 if the end has been reached, 1 otherwise
+int DEQUE_Next(DEQUE_Iterator* iterator);
+
+// gets the current element from an iterator
+// takes a pointer to the iterator
+// returns the value
+POLY_Polymorphic DEQUE_Peek(DEQUE_Iterator* iterator);
+
+// resets an iterator to the beginning
+// takes a pointer to the iterator
+void DEQUE_Reset(DEQUE_Iterator* iterator);
+
+#endif
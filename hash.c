@@ -0,0 +1,318 @@
+/*
+Source file for hash set or hash map implementation
+
+Copyright (C) 2016 Kyle Gagner
+All Rights Reserved
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "hash.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// control byte of a slot which has never held a key
+#define EMPTY ((signed char)-128)
+
+// control byte of a slot whose key was deleted, probing continues past it
+#define DELETED ((signed char)-2)
+
+// smallest capacity of a table, one group
+#define MINIMUM HASH_GROUP
+
+// the part of a hash that picks where probing starts
+#define H1(hash) ((hash) >> 7)
+
+// the part of a hash stored in the control byte
+#define H2(hash) ((signed char)((hash) & 0x7F))
+
+// helper function finds the slots of a group whose control bytes equal a value
+// takes a pointer to the first control byte of the group and the value
+// returns a mask with bit i set if slot i of the group matches
+unsigned int HASH_Match(signed char *controls, signed char value)
+{
+#ifdef __SSE2__
+	__m128i group = _mm_loadu_si128((__m128i*)controls);
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(value), group));
+#else
+	unsigned int mask = 0;
+	for(int i = 0; i < HASH_GROUP; i++) if(controls[i] == value) mask |= 1u << i;
+	return mask;
+#endif
+}
+
+// helper function finds the slots of a group which are empty or deleted
+// takes a pointer to the first control byte of the group
+// returns a mask with bit i set if slot i of the group is free
+unsigned int HASH_MatchFree(signed char *controls)
+{
+#ifdef __SSE2__
+	__m128i group = _mm_loadu_si128((__m128i*)controls);
+	return _mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(-1), group));
+#else
+	unsigned int mask = 0;
+	for(int i = 0; i < HASH_GROUP; i++) if(controls[i] < -1) mask |= 1u << i;
+	return mask;
+#endif
+}
+
+// helper function finds the index of the lowest set bit of a nonzero mask
+int HASH_LowestBit(unsigned int mask)
+{
+	int index = 0;
+	while(!(mask & 1))
+	{
+		mask >>= 1;
+		index++;
+	}
+	return index;
+}
+
+// helper function sets the control byte of a slot, along with its mirror past the end of the table
+// the first group is mirrored after the last slot so a group may be loaded starting at any slot
+// takes a pointer to the table, the index of the slot and the control byte
+void HASH_SetControl(HASH_Table *table, unsigned long index, signed char control)
+{
+	table->controls[index] = control;
+	if(index < HASH_GROUP) table->controls[table->capacity + index] = control;
+}
+
+// helper function allocates the slots of a table, all empty
+// takes a pointer to the table and its capacity, a power of two
+void HASH_Allocate(HASH_Table *table, unsigned long capacity)
+{
+	table->capacity = capacity;
+	table->controls = malloc(capacity + HASH_GROUP);
+	memset(table->controls, EMPTY, capacity + HASH_GROUP);
+	table->keys = malloc(sizeof(POLY_Polymorphic)*capacity);
+	table->values = malloc(sizeof(POLY_Polymorphic)*capacity);
+	table->growth = capacity - capacity/8;
+}
+
+HASH_Table *HASH_Initialize(HASH_Table *table, AVL_Destroyer kfree, AVL_Destroyer vfree, HASH_Hasher hasher, HASH_Equality equality)
+{
+	table->controls = NULL;
+	table->keys = NULL;
+	table->values = NULL;
+	table->capacity = 0;
+	table->size = 0;
+	table->growth = 0;
+	table->hasher = hasher;
+	table->equality = equality;
+	table->kfree = kfree;
+	table->vfree = vfree;
+	return table;
+}
+
+void HASH_Clear(HASH_Table *table)
+{
+	for(unsigned long i = 0; i < table->capacity; i++)
+	{
+		if(table->controls[i] < 0) continue;
+		if(table->kfree) table->kfree(table->keys[i]);
+		if(table->vfree) table->vfree(table->values[i]);
+	}
+	free(table->controls);
+	free(table->keys);
+	free(table->values);
+	HASH_Initialize(table, table->kfree, table->vfree, table->hasher, table->equality);
+}
+
+// helper function finds the slot holding a key
+// takes a pointer to the table, the key and its hash
+// returns the index of the slot or -1 if not found
+long HASH_Find(HASH_Table *table, POLY_Polymorphic key, unsigned long long hash)
+{
+	if(!table->capacity) return -1;
+	unsigned long mask = table->capacity - 1;
+	unsigned long position = H1(hash) & mask;
+	unsigned long step = 0;
+	while(1)
+	{
+		signed char *group = table->controls + position;
+		unsigned int matches = HASH_Match(group, H2(hash));
+		while(matches)
+		{
+			int bit = HASH_LowestBit(matches);
+			unsigned long index = (position + bit) & mask;
+			if(table->equality(key, table->keys[index])) return index;
+			matches &= matches - 1;
+		}
+		if(HASH_Match(group, EMPTY)) return -1;
+		step += HASH_GROUP;
+		position = (position + step) & mask;
+	}
+}
+
+// helper function finds the first free slot along the probe sequence of a hash
+// takes a pointer to the table and the hash
+// returns the index of the slot
+unsigned long HASH_FindFree(HASH_Table *table, unsigned long long hash)
+{
+	unsigned long mask = table->capacity - 1;
+	unsigned long position = H1(hash) & mask;
+	unsigned long step = 0;
+	while(1)
+	{
+		unsigned int slots = HASH_MatchFree(table->controls + position);
+		if(slots) return (position + HASH_LowestBit(slots)) & mask;
+		step += HASH_GROUP;
+		position = (position + step) & mask;
+	}
+}
+
+// helper function moves every item into newly allocated slots, dropping deleted slots
+// takes a pointer to the table and the new capacity
+void HASH_Rehash(HASH_Table *table, unsigned long capacity)
+{
+	signed char *controls = table->controls;
+	POLY_Polymorphic *keys = table->keys;
+	POLY_Polymorphic *values = table->values;
+	unsigned long old = table->capacity;
+	HASH_Allocate(table, capacity);
+	for(unsigned long i = 0; i < old; i++)
+	{
+		if(controls[i] < 0) continue;
+		unsigned long long hash = table->hasher(keys[i]);
+		unsigned long index = HASH_FindFree(table, hash);
+		HASH_SetControl(table, index, H2(hash));
+		table->keys[index] = keys[i];
+		table->values[index] = values[i];
+	}
+	table->growth -= table->size;
+	free(controls);
+	free(keys);
+	free(values);
+}
+
+POLY_Polymorphic HASH_Get(HASH_Table *table, POLY_Polymorphic key)
+{
+	long index = HASH_Find(table, key, table->hasher(key));
+	if(index >= 0) return table->values[index];
+	else return POLY_DEFAULT;
+}
+
+void HASH_Set(HASH_Table *table, POLY_Polymorphic key, POLY_Polymorphic value)
+{
+	unsigned long long hash = table->hasher(key);
+	long found = HASH_Find(table, key, hash);
+	if(found >= 0)
+	{
+		if(table->vfree) table->vfree(table->values[found]);
+		table->values[found] = value;
+		return;
+	}
+	if(!table->capacity) HASH_Allocate(table, MINIMUM);
+	unsigned long index = HASH_FindFree(table, hash);
+	if(!table->growth && table->controls[index] == EMPTY)
+	{
+		// grow if the table is more than half full, otherwise only clear out deleted slots
+		HASH_Rehash(table, table->size*2 > table->capacity - table->capacity/8 ? table->capacity*2 : table->capacity);
+		index = HASH_FindFree(table, hash);
+	}
+	if(table->controls[index] == EMPTY) table->growth--;
+	HASH_SetControl(table, index, H2(hash));
+	table->keys[index] = key;
+	table->values[index] = value;
+	table->size++;
+}
+
+void HASH_Insert(HASH_Table *table, POLY_Polymorphic key)
+{
+	HASH_Set(table, key, POLY_DEFAULT);
+}
+
+void HASH_Delete(HASH_Table *table, POLY_Polymorphic key)
+{
+	long index = HASH_Find(table, key, table->hasher(key));
+	if(index < 0) return;
+	if(table->kfree) table->kfree(table->keys[index]);
+	if(table->vfree) table->vfree(table->values[index]);
+	// a slot may become empty again only if no probe sequence can have passed over it while it was full,
+	// which holds when the group around it has never been completely full
+	unsigned long mask = table->capacity - 1;
+	unsigned int after = HASH_Match(table->controls + index, EMPTY);
+	unsigned int before = HASH_Match(table->controls + ((index - HASH_GROUP) & mask), EMPTY);
+	int run = 0;
+	while(run < HASH_GROUP && !(after & (1u << run))) run++;
+	int back = 0;
+	while(back < HASH_GROUP && !(before & (1u << (HASH_GROUP - 1 - back)))) back++;
+	if(run + back < HASH_GROUP)
+	{
+		HASH_SetControl(table, index, EMPTY);
+		table->growth++;
+	}
+	else HASH_SetControl(table, index, DELETED);
+	table->size--;
+}
+
+int HASH_Contains(HASH_Table *table, POLY_Polymorphic key)
+{
+	return HASH_Find(table, key, table->hasher(key)) >= 0 ? 1 : 0;
+}
+
+unsigned long HASH_Size(HASH_Table *table)
+{
+	return table->size;
+}
+
+HASH_Iterator *HASH_InitializeIterator(HASH_Table *table, HASH_Iterator *iterator)
+{
+	iterator->table = table;
+	iterator->index = table->capacity;
+	return iterator;
+}
+
+int HASH_Next(HASH_Iterator *iterator)
+{
+	HASH_Table *table = iterator->table;
+	unsigned long index = iterator->index < table->capacity ? iterator->index + 1 : 0;
+	while(index < table->capacity && table->controls[index] < 0) index++;
+	iterator->index = index;
+	return index < table->capacity;
+}
+
+POLY_Polymorphic HASH_Key(HASH_Iterator *iterator)
+{
+	if(iterator->index < iterator->table->capacity) return iterator->table->keys[iterator->index];
+	else return POLY_DEFAULT;
+}
+
+POLY_Polymorphic HASH_Value(HASH_Iterator *iterator)
+{
+	if(iterator->index < iterator->table->capacity) return iterator->table->values[iterator->index];
+	else return POLY_DEFAULT;
+}
+
+void HASH_Reset(HASH_Iterator *iterator)
+{
+	iterator->index = iterator->table->capacity;
+}
+
+void HASH_Destroy(POLY_Polymorphic item)
+{
+	HASH_Clear(HASH_POLYTABLE(item));
+	free(HASH_POLYTABLE(item));
+}
+
+unsigned long long HASH_Mix(unsigned long long value)
+{
+	value ^= value >> 33;
+	value *= 0xFF51AFD7ED558CCDULL;
+	value ^= value >> 33;
+	value *= 0xC4CEB9FE1A85EC53ULL;
+	value ^= value >> 33;
+	return value;
+}
+
+unsigned long long HASH_UINT64Hasher(POLY_Polymorphic key)
+{
+	return HASH_Mix(key.uint64);
+}
+
+int HASH_UINT64Equality(POLY_Polymorphic key1, POLY_Polymorphic key2)
+{
+	return key1.uint64 == key2.uint64;
+}
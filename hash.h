@@ -0,0 +1,131 @@
+/*
+Header file for hash set or hash map implementation
+
+Copyright (C) 2016 Kyle Gagner
+All Rights Reserved
+*/
+
+// for polymorphism
+#include "poly.h"
+// for destroyer type
+#include "avl.h"
+
+// include guard
+#ifndef HASH_H
+#define HASH_H
+
+// number of slots whose control bytes are matched at once
+#define HASH_GROUP 16
+
+// casting polymorphism
+#define HASH_POLYTABLE(value) ((HASH_Table*)value.ref)
+
+// function pointer type for hasher used to place keys in the table
+// takes the key to hash
+// returns the hash, which should be well mixed in all bits, see HASH_Mix
+typedef unsigned long long (*HASH_Hasher)(POLY_Polymorphic key);
+
+// function pointer type for equality test of keys
+// takes the keys to compare
+// returns nonzero if key1 == key2, zero otherwise
+typedef int (*HASH_Equality)(POLY_Polymorphic key1, POLY_Polymorphic key2);
+
+// represents a hash table using open addressing
+// each slot has a control byte which is empty, deleted, or holds 7 bits of the hash of the key in the slot,
+// and control bytes are matched a group at a time so most probes compare keys only when they are likely equal
+typedef struct HASH_Table
+{
+	signed char *controls;
+	POLY_Polymorphic *keys;
+	POLY_Polymorphic *values;
+	unsigned long capacity;
+	unsigned long size;
+	unsigned long growth;
+	HASH_Hasher hasher;
+	HASH_Equality equality;
+	AVL_Destroyer kfree;
+	AVL_Destroyer vfree;
+} HASH_Table;
+
+// represents an iterator for a hash table, the order of iteration is unspecified
+typedef struct HASH_Iterator
+{
+	HASH_Table *table;
+	unsigned long index;
+} HASH_Iterator;
+
+// initialize a table
+// takes a pointer to the memory to initialize, the functions used to destroy keys, destroy values, hash keys, and compare keys
+// kfree and vfree may be NULL
+// returns a pointer to the table
+HASH_Table *HASH_Initialize(HASH_Table *table, AVL_Destroyer kfree, AVL_Destroyer vfree, HASH_Hasher hasher, HASH_Equality equality);
+
+// remove all items from a table and free associated memory
+// takes a pointer to the table
+void HASH_Clear(HASH_Table *table);
+
+// get the value associated with a key
+// takes a pointer to the table to search and the key
+// returns the value or POLY_DEFAULT if not found
+POLY_Polymorphic HASH_Get(HASH_Table *table, POLY_Polymorphic key);
+
+// set the value associated with a key
+// takes a pointer to the table and the key and value
+void HASH_Set(HASH_Table *table, POLY_Polymorphic key, POLY_Polymorphic value);
+
+// insert a key into a table with no associated value
+// takes a pointer to the table and the key
+void HASH_Insert(HASH_Table *table, POLY_Polymorphic key);
+
+// delete a key from a table
+// takes a pointer to the table and the key
+void HASH_Delete(HASH_Table *table, POLY_Polymorphic key);
+
+// determines whether a table contains a key
+// takes a pointer to the table to search and the key
+// returns 1 if the table contains the key, returns 0 otherwise
+int HASH_Contains(HASH_Table *table, POLY_Polymorphic key);
+
+// gets the size of a table
+// takes a pointer to the table
+// returns the number of items in the table
+unsigned long HASH_Size(HASH_Table *table);
+
+// initializes an iterator for a table
+// takes a pointer to the table to iterate over and the memory to initialize
+// returns an iterator for that table
+HASH_Iterator *HASH_InitializeIterator(HASH_Table *table, HASH_Iterator *iterator);
+
+// gets the next element from an iterator
+// takes a pointer to the iterator
+// returns 0 if the end has been reached, 1 otherwise
+int HASH_Next(HASH_Iterator *iterator);
+
+// gets the key of the current element of an iterator
+// takes a pointer to the iterator
+// returns the key
+POLY_Polymorphic HASH_Key(HASH_Iterator *iterator);
+
+// gets the value of the current element of an iterator
+// takes a pointer to the iterator
+// returns the value
+POLY_Polymorphic HASH_Value(HASH_Iterator *iterator);
+
+// resets an iterator to the beginning
+// takes a pointer to the iterator
+void HASH_Reset(HASH_Iterator *iterator);
+
+// a function to clear a table and free the pointer to the table
+// takes a pointer to the table to destroy
+void HASH_Destroy(POLY_Polymorphic item);
+
+// mixes the bits of a 64 bit integer, for building hashers
+// takes the integer
+// returns the mixed integer
+unsigned long long HASH_Mix(unsigned long long value);
+
+// hasher and equality test for keys stored as uint64s or references
+unsigned long long HASH_UINT64Hasher(POLY_Polymorphic key);
+int HASH_UINT64Equality(POLY_Polymorphic key1, POLY_Polymorphic key2);
+
+#endif
@@ -7,6 +7,7 @@ All Rights Reserved
 
 #include <stdlib.h>
 #include "list.h"
+#include "mem.h"
 
 LIST_List* LIST_Initialize(LIST_List* list)
 {
@@ -20,7 +21,7 @@ LIST_List* LIST_Initialize(LIST_List* list)
 // takes a pointer to the list and the node to destroy
 void LIST_DestroyNode(LIST_List* list, LIST_Node* node)
 {
-	free(node);
+	MEM_RELEASE(MEM_LIST, node, sizeof(LIST_Node));
 }
 
 // remove all items from a list and free memory
@@ -34,14 +35,14 @@ void LIST_Clear(LIST_List* list)
 		LIST_DestroyNode(list, node);
 		node = next;
 	}
-	list->size = 0;
+	LIST_Initialize(list);
 }
 
 // helper function inserts a node between two other nodes or at either end of a list
 // takes a pointer to the list, the value to insert, and pointers to the previous and next nodes
 void LIST_Insert(LIST_List* list, POLY_Polymorphic value, LIST_Node* prev, LIST_Node* next)
 {
-	LIST_Node* node = (LIST_Node*)malloc(sizeof(LIST_Node));
+	LIST_Node* node = MEM_ALLOCATE(MEM_LIST, sizeof(LIST_Node));
 	node->value = value;
 	node->prev = prev;
 	node->next = next;
@@ -139,3 +140,90 @@ void LIST_Reset(LIST_Iterator* iterator)
 	iterator->current = NULL;
 }
 
+
+// helper function links a chain of nodes between two other nodes or at either end of a list
+// takes a pointer to the list, the first and last nodes of the chain, the number of nodes in it, and pointers to the previous and next nodes
+void LIST_Link(LIST_List* list, LIST_Node* first, LIST_Node* last, unsigned long count, LIST_Node* prev, LIST_Node* next)
+{
+	first->prev = prev;
+	last->next = next;
+	if(prev) prev->next = first;
+	else list->first = first;
+	if(next) next->prev = last;
+	else list->last = last;
+	list->size += count;
+}
+
+void LIST_Concat(LIST_List* list, LIST_List* other)
+{
+	if(!other->first) return;
+	LIST_Link(list, other->first, other->last, other->size, list->last, NULL);
+	LIST_Initialize(other);
+}
+
+void LIST_Splice(LIST_Iterator* iterator, LIST_List* other)
+{
+	LIST_List* list = iterator->list;
+	if(!other->first) return;
+	if(iterator->current) LIST_Link(list, other->first, other->last, other->size, iterator->current, iterator->current->next);
+	else LIST_Link(list, other->first, other->last, other->size, NULL, list->first);
+	LIST_Initialize(other);
+}
+
+void LIST_Split(LIST_Iterator* iterator, LIST_List* rest)
+{
+	LIST_List* list = iterator->list;
+	LIST_Node* first = iterator->current ? iterator->current->next : list->first;
+	if(!first) return;
+	// the nodes moved are counted, which is the only part of a split that is not constant time
+	unsigned long count = 0;
+	for(LIST_Node* node = first; node; node = node->next) count++;
+	LIST_Link(rest, first, list->last, count, rest->last, NULL);
+	list->last = iterator->current;
+	if(iterator->current) iterator->current->next = NULL;
+	else list->first = NULL;
+	list->size -= count;
+}
+
+void LIST_InsertAfter(LIST_Iterator* iterator, POLY_Polymorphic value)
+{
+	LIST_List* list = iterator->list;
+	if(iterator->current)
+	{
+		LIST_Insert(list, value, iterator->current, iterator->current->next);
+		iterator->current = iterator->current->next;
+	}
+	else
+	{
+		LIST_Insert(list, value, NULL, list->first);
+		iterator->current = list->first;
+	}
+}
+
+POLY_Polymorphic LIST_Remove(LIST_Iterator* iterator)
+{
+	LIST_Node* node = iterator->current;
+	if(!node) return POLY_DEFAULT;
+	POLY_Polymorphic value = node->value;
+	iterator->current = node->prev;
+	LIST_Delete(iterator->list, node);
+	return value;
+}
+
+void LIST_InsertArray(LIST_List* list, POLY_Polymorphic* values, unsigned long count)
+{
+	if(!count) return;
+	// the nodes are chained among themselves and linked into the list once
+	LIST_Node* first = MEM_ALLOCATE(MEM_LIST, sizeof(LIST_Node));
+	LIST_Node* last = first;
+	first->value = values[0];
+	for(unsigned long n = 1; n < count; n++)
+	{
+		LIST_Node* node = MEM_ALLOCATE(MEM_LIST, sizeof(LIST_Node));
+		node->value = values[n];
+		node->prev = last;
+		last->next = node;
+		last = node;
+	}
+	LIST_Link(list, first, last, count, list->last, NULL);
+}
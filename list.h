@@ -100,4 +100,33 @@ POLY_Polymorphic LIST_Peek(LIST_Iterator* iterator);
 // takes a pointer to the iterator
 void LIST_Reset(LIST_Iterator* iterator);
 
+// move every element of another list to the tail of a list, without allocating
+// takes a pointer to the list and a pointer to the other list, which is left empty
+void LIST_Concat(LIST_List* list, LIST_List* other);
+
+// move every element of another list after the current element of an iterator, or to the head of the list if the iterator is reset,
+// without allocating
+// takes a pointer to the iterator and a pointer to the other list, which is left empty
+void LIST_Splice(LIST_Iterator* iterator, LIST_List* other);
+
+// move every element after the current element of an iterator, or every element if the iterator is reset, to the tail of another list,
+// without allocating, in time proportional to the number of elements moved
+// takes a pointer to the iterator and a pointer to the other list
+void LIST_Split(LIST_Iterator* iterator, LIST_List* rest);
+
+// insert after the current element of an iterator, or at the head of the list if the iterator is reset
+// takes a pointer to the iterator and the value to insert
+// the iterator moves to the value inserted
+void LIST_InsertAfter(LIST_Iterator* iterator, POLY_Polymorphic value);
+
+// remove the current element of an iterator
+// takes a pointer to the iterator
+// the iterator moves to the element before, or is reset if there is none, so the next element is the one after the one removed
+// returns the value removed
+POLY_Polymorphic LIST_Remove(LIST_Iterator* iterator);
+
+// insert the values of an array at the tail of a list, in order
+// takes a pointer to the list, the array and the number of values in it
+void LIST_InsertArray(LIST_List* list, POLY_Polymorphic* values, unsigned long count);
+
 #endif
@@ -0,0 +1,68 @@
+/*
+Source file for memory accounting
+
+Copyright (C) 2016 Kyle Gagner
+All Rights Reserved
+*/
+
+#include <stdatomic.h>
+#include "mem.h"
+
+// counts of every subsystem, shared by every thread
+_Atomic unsigned long MEM_allocations[MEM_SUBSYSTEMS];
+_Atomic unsigned long MEM_frees[MEM_SUBSYSTEMS];
+_Atomic unsigned long MEM_live[MEM_SUBSYSTEMS];
+_Atomic unsigned long MEM_peak[MEM_SUBSYSTEMS];
+
+// names of the subsystems
+const char *MEM_names[MEM_SUBSYSTEMS] = {"avl", "list", "nfa", "dfa", "sets", "machine"};
+
+void *MEM_Allocate(MEM_Subsystem subsystem, unsigned long size)
+{
+	atomic_fetch_add_explicit(&MEM_allocations[subsystem], 1, memory_order_relaxed);
+	unsigned long live = atomic_fetch_add_explicit(&MEM_live[subsystem], size, memory_order_relaxed) + size;
+	unsigned long peak = atomic_load_explicit(&MEM_peak[subsystem], memory_order_relaxed);
+	while(live > peak && !atomic_compare_exchange_weak_explicit(&MEM_peak[subsystem], &peak, live, memory_order_relaxed, memory_order_relaxed));
+	return malloc(size);
+}
+
+void MEM_Release(MEM_Subsystem subsystem, void *pointer, unsigned long size)
+{
+	if(!pointer) return;
+	atomic_fetch_add_explicit(&MEM_frees[subsystem], 1, memory_order_relaxed);
+	atomic_fetch_sub_explicit(&MEM_live[subsystem], size, memory_order_relaxed);
+	free(pointer);
+}
+
+MEM_Snapshot *MEM_TakeSnapshot(MEM_Snapshot *snapshot)
+{
+	for(int n = 0; n < MEM_SUBSYSTEMS; n++)
+	{
+		snapshot->counts[n].allocations = atomic_load_explicit(&MEM_allocations[n], memory_order_relaxed);
+		snapshot->counts[n].frees = atomic_load_explicit(&MEM_frees[n], memory_order_relaxed);
+		snapshot->counts[n].live = atomic_load_explicit(&MEM_live[n], memory_order_relaxed);
+		snapshot->counts[n].peak = atomic_load_explicit(&MEM_peak[n], memory_order_relaxed);
+	}
+	return snapshot;
+}
+
+unsigned long MEM_Live(MEM_Snapshot *snapshot)
+{
+	unsigned long live = 0;
+	for(int n = 0; n < MEM_SUBSYSTEMS; n++) live += snapshot->counts[n].live;
+	return live;
+}
+
+const char *MEM_Name(MEM_Subsystem subsystem)
+{
+	return MEM_names[subsystem];
+}
+
+int MEM_Accounting()
+{
+#ifdef MEM_ACCOUNTING
+	return 1;
+#else
+	return 0;
+#endif
+}
@@ -0,0 +1,81 @@
+/*
+Header file for memory accounting
+
+Copyright (C) 2016 Kyle Gagner
+All Rights Reserved
+*/
+
+// for malloc and free
+#include <stdlib.h>
+
+// include guard
+#ifndef MEM_H
+#define MEM_H
+
+// memory is accounted only when compiled with MEM_ACCOUNTING defined, otherwise the macros below are malloc and free
+#ifdef MEM_ACCOUNTING
+#define MEM_ALLOCATE(subsystem, size) MEM_Allocate(subsystem, size)
+#define MEM_RELEASE(subsystem, pointer, size) MEM_Release(subsystem, pointer, size)
+#else
+#define MEM_ALLOCATE(subsystem, size) malloc(size)
+#define MEM_RELEASE(subsystem, pointer, size) free(pointer)
+#endif
+
+// the subsystems memory is accounted to
+// MEM_SETS is AVL trees allocated on their own, such as the sets of states of the regular expression compiler, and not their nodes
+typedef enum
+{
+	MEM_AVL,
+	MEM_LIST,
+	MEM_NFA,
+	MEM_DFA,
+	MEM_SETS,
+	MEM_MACHINE,
+	MEM_SUBSYSTEMS
+} MEM_Subsystem;
+
+// represents the memory of a subsystem
+// live is the number of bytes allocated and not yet freed, and peak is the most bytes that were live at once
+typedef struct
+{
+	unsigned long allocations;
+	unsigned long frees;
+	unsigned long live;
+	unsigned long peak;
+} MEM_Counts;
+
+// represents the memory of every subsystem at one time
+typedef struct
+{
+	MEM_Counts counts[MEM_SUBSYSTEMS];
+} MEM_Snapshot;
+
+// allocate memory accounted to a subsystem, used through MEM_ALLOCATE
+// takes the subsystem and the number of bytes
+// returns a pointer to the memory
+void *MEM_Allocate(MEM_Subsystem subsystem, unsigned long size);
+
+// free memory accounted to a subsystem, used through MEM_RELEASE
+// takes the subsystem, a pointer to the memory, and the number of bytes it was allocated with
+void MEM_Release(MEM_Subsystem subsystem, void *pointer, unsigned long size);
+
+// takes a snapshot of the memory of every subsystem, all zero if memory is not accounted
+// takes a pointer to the snapshot
+// returns a pointer to the snapshot
+MEM_Snapshot *MEM_TakeSnapshot(MEM_Snapshot *snapshot);
+
+// finds the total bytes live in a snapshot
+// takes a pointer to the snapshot
+// returns the number of bytes
+unsigned long MEM_Live(MEM_Snapshot *snapshot);
+
+// gets the name of a subsystem
+// takes the subsystem
+// returns the name
+const char *MEM_Name(MEM_Subsystem subsystem);
+
+// determines whether memory is accounted
+// returns 1 if the library was compiled with MEM_ACCOUNTING, 0 otherwise
+int MEM_Accounting();
+
+#endif
@@ -0,0 +1,312 @@
+/*
+Source file for persistent AVL tree set or tree map implementation
+
+Copyright (C) 2016 Kyle Gagner
+All Rights Reserved
+*/
+
+#include <stdlib.h>
+#include "pavl.h"
+
+PAVL_Tree *PAVL_Initialize(PAVL_Tree *tree, AVL_Destroyer kfree, AVL_Destroyer vfree, AVL_Comparator comparator)
+{
+	tree->root = NULL;
+	tree->size = 0;
+	tree->comparator = comparator;
+	tree->kfree = kfree;
+	tree->vfree = vfree;
+	return tree;
+}
+
+// helper function adds a reference to a node
+// takes a pointer to the node, which may be NULL
+// returns the node
+PAVL_Node *PAVL_Retain(PAVL_Node *node)
+{
+	if(node) atomic_fetch_add_explicit(&node->references, 1, memory_order_relaxed);
+	return node;
+}
+
+// helper function allocates a count of nodes sharing a key or value, if the tree destroys them
+// takes the destroyer for the key or value
+// returns a pointer to the count, which is 1, or NULL if there is no destroyer
+_Atomic unsigned long *PAVL_CreateShares(AVL_Destroyer destroyer)
+{
+	if(!destroyer) return NULL;
+	_Atomic unsigned long *shares = malloc(sizeof(_Atomic unsigned long));
+	atomic_init(shares, 1);
+	return shares;
+}
+
+// helper function removes a node from the count of nodes sharing a key or value, destroying it if no node is left
+// takes the count, which may be NULL, the destroyer and the key or value
+void PAVL_Unshare(_Atomic unsigned long *shares, AVL_Destroyer destroyer, POLY_Polymorphic item)
+{
+	if(shares && atomic_fetch_sub_explicit(shares, 1, memory_order_acq_rel) == 1)
+	{
+		destroyer(item);
+		free(shares);
+	}
+}
+
+// helper function removes a reference to a node, freeing it and releasing its children if none is left
+// takes a pointer to the tree and the node, which may be NULL
+void PAVL_Release(PAVL_Tree *tree, PAVL_Node *node)
+{
+	if(!node || atomic_fetch_sub_explicit(&node->references, 1, memory_order_acq_rel) != 1) return;
+	PAVL_Release(tree, node->left);
+	PAVL_Release(tree, node->right);
+	PAVL_Unshare(node->kshares, tree->kfree, node->key);
+	PAVL_Unshare(node->vshares, tree->vfree, node->value);
+	free(node);
+}
+
+void PAVL_Clear(PAVL_Tree *tree)
+{
+	PAVL_Release(tree, tree->root);
+	tree->root = NULL;
+	tree->size = 0;
+}
+
+PAVL_Tree *PAVL_Snapshot(PAVL_Tree *snapshot, PAVL_Tree *tree)
+{
+	*snapshot = *tree;
+	PAVL_Retain(snapshot->root);
+	return snapshot;
+}
+
+// helper function gets the node associated with a key
+// takes a pointer to the tree to search and the key
+// returns a pointer to the node or NULL if not found
+PAVL_Node *PAVL_GetNode(PAVL_Tree *tree, POLY_Polymorphic key)
+{
+	PAVL_Node *current = tree->root;
+	int comparison;
+	while(current && (comparison = tree->comparator(key, current->key)))
+	{
+		if(comparison > 0) current = current->right;
+		else current = current->left;
+	}
+	return current;
+}
+
+POLY_Polymorphic PAVL_Get(PAVL_Tree *tree, POLY_Polymorphic key)
+{
+	PAVL_Node *node = PAVL_GetNode(tree, key);
+	if(node) return node->value;
+	else return POLY_DEFAULT;
+}
+
+// helper function gets the height of a subtree
+// takes a pointer to the root of the subtree, which may be NULL
+// returns the height
+int PAVL_Height(PAVL_Node *node)
+{
+	return node ? node->height : 0;
+}
+
+// helper function allocates a node
+// takes the key and value of the node, the counts of nodes sharing them, and its children, whose references the node takes over
+// returns a pointer to the node, with one reference
+PAVL_Node *PAVL_CreateNode(POLY_Polymorphic key, POLY_Polymorphic value, _Atomic unsigned long *kshares, _Atomic unsigned long *vshares, PAVL_Node *left, PAVL_Node *right)
+{
+	PAVL_Node *node = malloc(sizeof(PAVL_Node));
+	node->left = left;
+	node->right = right;
+	atomic_init(&node->references, 1);
+	int heightl = PAVL_Height(left);
+	int heightr = PAVL_Height(right);
+	node->height = (heightl > heightr ? heightl : heightr) + 1;
+	node->key = key;
+	node->value = value;
+	node->kshares = kshares;
+	node->vshares = vshares;
+	return node;
+}
+
+// helper function allocates a copy of a node with different children, sharing its key and value
+// takes a pointer to the node to copy and the children, whose references the copy takes over
+// returns a pointer to the copy, with one reference
+PAVL_Node *PAVL_CopyNode(PAVL_Node *node, PAVL_Node *left, PAVL_Node *right)
+{
+	if(node->kshares) atomic_fetch_add_explicit(node->kshares, 1, memory_order_relaxed);
+	if(node->vshares) atomic_fetch_add_explicit(node->vshares, 1, memory_order_relaxed);
+	return PAVL_CreateNode(node->key, node->value, node->kshares, node->vshares, left, right);
+}
+
+// helper function copies a node with different children whose heights may differ by two, rotating to restore balance
+// takes a pointer to the tree, the node to copy and the children, whose references the copy takes over
+// returns a pointer to the root of the balanced subtree, with one reference
+PAVL_Node *PAVL_Balance(PAVL_Tree *tree, PAVL_Node *node, PAVL_Node *left, PAVL_Node *right)
+{
+	int heightl = PAVL_Height(left);
+	int heightr = PAVL_Height(right);
+	PAVL_Node *balanced;
+	if(heightl > heightr + 1)
+	{
+		if(PAVL_Height(left->left) >= PAVL_Height(left->right))
+			balanced = PAVL_CopyNode(left, PAVL_Retain(left->left), PAVL_CopyNode(node, PAVL_Retain(left->right), right));
+		else
+		{
+			PAVL_Node *pivot = left->right;
+			balanced = PAVL_CopyNode(pivot,
+				PAVL_CopyNode(left, PAVL_Retain(left->left), PAVL_Retain(pivot->left)),
+				PAVL_CopyNode(node, PAVL_Retain(pivot->right), right));
+		}
+		PAVL_Release(tree, left);
+	}
+	else if(heightr > heightl + 1)
+	{
+		if(PAVL_Height(right->right) >= PAVL_Height(right->left))
+			balanced = PAVL_CopyNode(right, PAVL_CopyNode(node, left, PAVL_Retain(right->left)), PAVL_Retain(right->right));
+		else
+		{
+			PAVL_Node *pivot = right->left;
+			balanced = PAVL_CopyNode(pivot,
+				PAVL_CopyNode(node, left, PAVL_Retain(pivot->left)),
+				PAVL_CopyNode(right, PAVL_Retain(pivot->right), PAVL_Retain(right->right)));
+		}
+		PAVL_Release(tree, right);
+	}
+	else balanced = PAVL_CopyNode(node, left, right);
+	return balanced;
+}
+
+// helper function copies the path to a key, setting its value
+// takes a pointer to the tree, the root of the subtree, the key and value, and a pointer to a flag set if the key is added
+// returns the root of the new subtree, with one reference
+PAVL_Node *PAVL_SetNode(PAVL_Tree *tree, PAVL_Node *node, POLY_Polymorphic key, POLY_Polymorphic value, int *added)
+{
+	if(!node)
+	{
+		*added = 1;
+		return PAVL_CreateNode(key, value, PAVL_CreateShares(tree->kfree), PAVL_CreateShares(tree->vfree), NULL, NULL);
+	}
+	int comparison = tree->comparator(key, node->key);
+	if(comparison < 0) return PAVL_Balance(tree, node, PAVL_SetNode(tree, node->left, key, value, added), PAVL_Retain(node->right));
+	if(comparison > 0) return PAVL_Balance(tree, node, PAVL_Retain(node->left), PAVL_SetNode(tree, node->right, key, value, added));
+	if(node->kshares) atomic_fetch_add_explicit(node->kshares, 1, memory_order_relaxed);
+	return PAVL_CreateNode(node->key, value, node->kshares, PAVL_CreateShares(tree->vfree), PAVL_Retain(node->left), PAVL_Retain(node->right));
+}
+
+// helper function copies the path to the least key of a subtree, removing it
+// takes a pointer to the tree, the root of the subtree, and a pointer to be set to the node removed
+// returns the root of the new subtree, with one reference
+PAVL_Node *PAVL_RemoveLeast(PAVL_Tree *tree, PAVL_Node *node, PAVL_Node **least)
+{
+	if(!node->left)
+	{
+		*least = node;
+		return PAVL_Retain(node->right);
+	}
+	return PAVL_Balance(tree, node, PAVL_RemoveLeast(tree, node->left, least), PAVL_Retain(node->right));
+}
+
+// helper function copies the path to a key which is in a subtree, removing it
+// takes a pointer to the tree, the root of the subtree, and the key
+// returns the root of the new subtree, with one reference
+PAVL_Node *PAVL_DeleteNode(PAVL_Tree *tree, PAVL_Node *node, POLY_Polymorphic key)
+{
+	int comparison = tree->comparator(key, node->key);
+	if(comparison < 0) return PAVL_Balance(tree, node, PAVL_DeleteNode(tree, node->left, key), PAVL_Retain(node->right));
+	if(comparison > 0) return PAVL_Balance(tree, node, PAVL_Retain(node->left), PAVL_DeleteNode(tree, node->right, key));
+	if(!node->left) return PAVL_Retain(node->right);
+	if(!node->right) return PAVL_Retain(node->left);
+	PAVL_Node *least;
+	PAVL_Node *right = PAVL_RemoveLeast(tree, node->right, &least);
+	return PAVL_Balance(tree, least, PAVL_Retain(node->left), right);
+}
+
+// helper function makes a version from a new root, releasing the version it came from if it is replaced
+// takes a pointer to the memory for the new version, the version it came from, the new root and size
+// returns a pointer to the new version
+PAVL_Tree *PAVL_Replace(PAVL_Tree *version, PAVL_Tree *tree, PAVL_Node *root, unsigned long size)
+{
+	if(version == tree) PAVL_Release(tree, tree->root);
+	else PAVL_Initialize(version, tree->kfree, tree->vfree, tree->comparator);
+	version->root = root;
+	version->size = size;
+	return version;
+}
+
+PAVL_Tree *PAVL_Set(PAVL_Tree *version, PAVL_Tree *tree, POLY_Polymorphic key, POLY_Polymorphic value)
+{
+	int added = 0;
+	PAVL_Node *root = PAVL_SetNode(tree, tree->root, key, value, &added);
+	return PAVL_Replace(version, tree, root, tree->size + added);
+}
+
+PAVL_Tree *PAVL_Insert(PAVL_Tree *version, PAVL_Tree *tree, POLY_Polymorphic key)
+{
+	return PAVL_Set(version, tree, key, POLY_DEFAULT);
+}
+
+PAVL_Tree *PAVL_Delete(PAVL_Tree *version, PAVL_Tree *tree, POLY_Polymorphic key)
+{
+	if(!PAVL_GetNode(tree, key))
+	{
+		if(version != tree) PAVL_Snapshot(version, tree);
+		return version;
+	}
+	PAVL_Node *root = PAVL_DeleteNode(tree, tree->root, key);
+	return PAVL_Replace(version, tree, root, tree->size - 1);
+}
+
+int PAVL_Contains(PAVL_Tree *tree, POLY_Polymorphic key)
+{
+	return PAVL_GetNode(tree, key) ? 1 : 0;
+}
+
+unsigned long PAVL_Size(PAVL_Tree *tree)
+{
+	return tree->size;
+}
+
+PAVL_Iterator *PAVL_InitializeIterator(PAVL_Tree *tree, PAVL_Iterator *iterator)
+{
+	iterator->tree = tree;
+	iterator->depth = -1;
+	return iterator;
+}
+
+// helper function pushes a node and its chain of left children onto the path of an iterator
+// takes a pointer to the iterator and the node, which may be NULL
+void PAVL_Descend(PAVL_Iterator *iterator, PAVL_Node *node)
+{
+	while(node)
+	{
+		iterator->nodes[++iterator->depth] = node;
+		node = node->left;
+	}
+}
+
+int PAVL_Next(PAVL_Iterator *iterator)
+{
+	// the path is empty both before the first element and after the last, so iterating again starts over
+	if(iterator->depth < 0) PAVL_Descend(iterator, iterator->tree->root);
+	else PAVL_Descend(iterator, iterator->nodes[iterator->depth--]->right);
+	return iterator->depth >= 0;
+}
+
+POLY_Polymorphic PAVL_Key(PAVL_Iterator *iterator)
+{
+	if(iterator->depth >= 0) return iterator->nodes[iterator->depth]->key;
+	else return POLY_DEFAULT;
+}
+
+POLY_Polymorphic PAVL_Value(PAVL_Iterator *iterator)
+{
+	if(iterator->depth >= 0) return iterator->nodes[iterator->depth]->value;
+	else return POLY_DEFAULT;
+}
+
+void PAVL_Reset(PAVL_Iterator *iterator)
+{
+	iterator->depth = -1;
+}
+
+void PAVL_Destroy(POLY_Polymorphic item)
+{
+	PAVL_Clear(PAVL_POLYTREE(item));
+	free(PAVL_POLYTREE(item));
+}
@@ -0,0 +1,135 @@
+/*
+Header file for persistent AVL tree set or tree map implementation
+
+Copyright (C) 2016 Kyle Gagner
+All Rights Reserved
+*/
+
+// for atomics
+#include <stdatomic.h>
+// for polymorphism
+#include "poly.h"
+// for comparator and destroyer types
+#include "avl.h"
+
+// include guard
+#ifndef PAVL_H
+#define PAVL_H
+
+// maximum height of a tree, enough for any number of keys that fits in memory
+#define PAVL_DEPTH 96
+
+// casting polymorphism
+#define PAVL_POLYTREE(value) ((PAVL_Tree*)value.ref)
+
+// represents a node in a persistent AVL tree, nodes are never modified once created and are shared between versions
+// references counts the versions and nodes pointing to the node
+// keys and values are shared between copies of a node, kshares and vshares count the nodes sharing them,
+// and are only allocated when the tree destroys keys or values
+typedef struct PAVL_Node
+{
+	struct PAVL_Node *left;
+	struct PAVL_Node *right;
+	_Atomic unsigned long references;
+	int height;
+	POLY_Polymorphic key;
+	POLY_Polymorphic value;
+	_Atomic unsigned long *kshares;
+	_Atomic unsigned long *vshares;
+} PAVL_Node;
+
+// represents a version of a persistent AVL tree
+// versions may be read, snapshotted and cleared from different threads at once, but each version is modified by one thread at a time
+typedef struct PAVL_Tree
+{
+	PAVL_Node *root;
+	unsigned long size;
+	AVL_Comparator comparator;
+	AVL_Destroyer kfree;
+	AVL_Destroyer vfree;
+} PAVL_Tree;
+
+// represents an inorder iterator for a version of a persistent AVL tree
+// the iterator keeps the path from the root to the current key
+typedef struct PAVL_Iterator
+{
+	PAVL_Tree *tree;
+	PAVL_Node *nodes[PAVL_DEPTH];
+	int depth;
+} PAVL_Iterator;
+
+// initialize an empty tree
+// takes a pointer to the memory to initialize, the functions used to destroy keys, destroy values, and compare keys
+// kfree and vfree may be NULL, keys and values are destroyed once no version holds them
+// returns a pointer to the tree
+PAVL_Tree *PAVL_Initialize(PAVL_Tree *tree, AVL_Destroyer kfree, AVL_Destroyer vfree, AVL_Comparator comparator);
+
+// releases a version of a tree, leaving it empty, memory no other version shares is freed
+// takes a pointer to the version
+void PAVL_Clear(PAVL_Tree *tree);
+
+// takes a snapshot of a version of a tree in constant time, the snapshot is unaffected by later changes to the version
+// takes a pointer to the memory to initialize and the version
+// returns a pointer to the snapshot, which must be cleared when no longer needed
+PAVL_Tree *PAVL_Snapshot(PAVL_Tree *snapshot, PAVL_Tree *tree);
+
+// get the value associated with a key
+// takes a pointer to the version to search and the key
+// returns the value or POLY_DEFAULT if not found
+POLY_Polymorphic PAVL_Get(PAVL_Tree *tree, POLY_Polymorphic key);
+
+// makes a new version with the value associated with a key set, sharing all but O(log n) nodes with the version it came from
+// takes a pointer to the memory for the new version, the version to change, and the key and value
+// the new version may be the same as the version to change, replacing it, otherwise the memory is initialized
+// returns a pointer to the new version
+PAVL_Tree *PAVL_Set(PAVL_Tree *version, PAVL_Tree *tree, POLY_Polymorphic key, POLY_Polymorphic value);
+
+// makes a new version with a key inserted with no associated value
+// takes a pointer to the memory for the new version, the version to change, and the key
+// returns a pointer to the new version
+PAVL_Tree *PAVL_Insert(PAVL_Tree *version, PAVL_Tree *tree, POLY_Polymorphic key);
+
+// makes a new version with a key deleted
+// takes a pointer to the memory for the new version, the version to change, and the key
+// returns a pointer to the new version
+PAVL_Tree *PAVL_Delete(PAVL_Tree *version, PAVL_Tree *tree, POLY_Polymorphic key);
+
+// determines whether a version contains a key
+// takes a pointer to the version to search and the key
+// returns 1 if the version contains the key, returns 0 otherwise
+int PAVL_Contains(PAVL_Tree *tree, POLY_Polymorphic key);
+
+// gets the size of a version
+// takes a pointer to the version
+// returns the number of items in the version
+unsigned long PAVL_Size(PAVL_Tree *tree);
+
+// initializes an iterator for a version, the version must not change while the iterator is used
+// takes a pointer to the version to iterate over and the memory to initialize
+// returns an iterator for that version
+PAVL_Iterator *PAVL_InitializeIterator(PAVL_Tree *tree, PAVL_Iterator *iterator);
+
+// gets the next element from an iterator
+// takes a pointer to the iterator
+// returns 0 if the end has been reached, 1 otherwise
+int PAVL_Next(PAVL_Iterator *iterator);
+
+// gets the key of the current element of an iterator
+// takes a pointer to the iterator
+// returns the key
+POLY_Polymorphic PAVL_Key(PAVL_Iterator *iterator);
+
+// gets the value of the current element of an iterator
+// takes a pointer to the iterator
+// returns the value
+POLY_Polymorphic PAVL_Value(PAVL_Iterator *iterator);
+
+// resets an iterator to the beginning
+// takes a pointer to the iterator
+void PAVL_Reset(PAVL_Iterator *iterator);
+
+// a function to clear a version and free the pointer to the version
+// takes a pointer to the version to destroy
+void PAVL_Destroy(POLY_Polymorphic item);
+
+#endif
@@ -0,0 +1,173 @@
+/*
+Source file for bounded lock-free queue implementation
+
+Copyright (C) 2016 Kyle Gagner
+All Rights Reserved
+*/
+
+#include <stdlib.h>
+#include "queue.h"
+
+// smallest capacity of a queue
+#define MINIMUM 2
+
+// number of times a consumer tries an empty queue before waiting on it
+#define SPINS 64
+
+QUEUE_Queue *QUEUE_Initialize(QUEUE_Queue *queue, unsigned long capacity)
+{
+	unsigned long size = MINIMUM;
+	while(size < capacity) size *= 2;
+	queue->cells = malloc(sizeof(QUEUE_Cell)*size);
+	queue->capacity = size;
+	// every cell starts ready to be written at the first position which maps to it
+	for(unsigned long n = 0; n < size; n++) atomic_init(&queue->cells[n].sequence, n);
+	atomic_init(&queue->tail, 0);
+	atomic_init(&queue->head, 0);
+	atomic_init(&queue->waiters, 0);
+	atomic_init(&queue->closed, 0);
+	pthread_mutex_init(&queue->lock, NULL);
+	pthread_cond_init(&queue->available, NULL);
+	return queue;
+}
+
+void QUEUE_Clear(QUEUE_Queue *queue)
+{
+	free(queue->cells);
+	queue->cells = NULL;
+	queue->capacity = 0;
+	pthread_mutex_destroy(&queue->lock);
+	pthread_cond_destroy(&queue->available);
+}
+
+// helper function wakes consumers waiting on a queue after values are inserted
+// the check of waiters is ordered after the values are published, and a waiter is counted before it looks for values,
+// so either the waiter finds the values or it is counted here, and it cannot miss the wakeup since it holds the lock until it waits
+// takes a pointer to the queue and the number of values inserted
+void QUEUE_Wake(QUEUE_Queue *queue, unsigned long count)
+{
+	if(!atomic_load(&queue->waiters)) return;
+	pthread_mutex_lock(&queue->lock);
+	if(count == 1) pthread_cond_signal(&queue->available);
+	else pthread_cond_broadcast(&queue->available);
+	pthread_mutex_unlock(&queue->lock);
+}
+
+unsigned long QUEUE_InsertTailBatch(QUEUE_Queue *queue, POLY_Polymorphic *values, unsigned long count)
+{
+	unsigned long mask = queue->capacity - 1;
+	unsigned long position = atomic_load(&queue->tail);
+	unsigned long n;
+	if(!count) return 0;
+	while(1)
+	{
+		// a cell ready to be written at its position stays ready until that position is claimed,
+		// so the run of ready cells counted here can all be claimed together
+		unsigned long sequence;
+		for(n = 0; n < count; n++)
+		{
+			sequence = atomic_load(&queue->cells[(position + n) & mask].sequence);
+			if(sequence != position + n) break;
+		}
+		if(n)
+		{
+			if(atomic_compare_exchange_weak(&queue->tail, &position, position + n)) break;
+		}
+		// a cell still holding the value from a lap ago means the queue is full
+		else if((long)(sequence - position) < 0) return 0;
+		else position = atomic_load(&queue->tail);
+	}
+	for(unsigned long m = 0; m < n; m++)
+	{
+		QUEUE_Cell *cell = &queue->cells[(position + m) & mask];
+		cell->value = values[m];
+		atomic_store(&cell->sequence, position + m + 1);
+	}
+	QUEUE_Wake(queue, n);
+	return n;
+}
+
+int QUEUE_InsertTail(QUEUE_Queue *queue, POLY_Polymorphic value)
+{
+	return QUEUE_InsertTailBatch(queue, &value, 1);
+}
+
+unsigned long QUEUE_TakeHeadBatch(QUEUE_Queue *queue, POLY_Polymorphic *values, unsigned long count)
+{
+	unsigned long mask = queue->capacity - 1;
+	unsigned long position = atomic_load(&queue->head);
+	unsigned long n;
+	if(!count) return 0;
+	while(1)
+	{
+		unsigned long sequence;
+		for(n = 0; n < count; n++)
+		{
+			sequence = atomic_load(&queue->cells[(position + n) & mask].sequence);
+			if(sequence != position + n + 1) break;
+		}
+		if(n)
+		{
+			if(atomic_compare_exchange_weak(&queue->head, &position, position + n)) break;
+		}
+		// a cell not yet written at the position means the queue is empty
+		else if((long)(sequence - (position + 1)) < 0) return 0;
+		else position = atomic_load(&queue->head);
+	}
+	for(unsigned long m = 0; m < n; m++)
+	{
+		QUEUE_Cell *cell = &queue->cells[(position + m) & mask];
+		values[m] = cell->value;
+		// the cell is ready to be written at the position which maps to it on the next lap
+		atomic_store(&cell->sequence, position + m + queue->capacity);
+	}
+	return n;
+}
+
+int QUEUE_TryTakeHead(QUEUE_Queue *queue, POLY_Polymorphic *value)
+{
+	return QUEUE_TakeHeadBatch(queue, value, 1);
+}
+
+int QUEUE_TakeHead(QUEUE_Queue *queue, POLY_Polymorphic *value)
+{
+	// a value is often inserted soon after the queue empties, so trying again briefly avoids the lock
+	for(int n = 0; n < SPINS; n++) if(QUEUE_TakeHeadBatch(queue, value, 1)) return 1;
+	int taken;
+	pthread_mutex_lock(&queue->lock);
+	atomic_fetch_add(&queue->waiters, 1);
+	while(!(taken = QUEUE_TakeHeadBatch(queue, value, 1)))
+	{
+		if(atomic_load(&queue->closed))
+		{
+			taken = QUEUE_TakeHeadBatch(queue, value, 1);
+			break;
+		}
+		pthread_cond_wait(&queue->available, &queue->lock);
+	}
+	atomic_fetch_sub(&queue->waiters, 1);
+	pthread_mutex_unlock(&queue->lock);
+	return taken;
+}
+
+void QUEUE_Close(QUEUE_Queue *queue)
+{
+	atomic_store(&queue->closed, 1);
+	pthread_mutex_lock(&queue->lock);
+	pthread_cond_broadcast(&queue->available);
+	pthread_mutex_unlock(&queue->lock);
+}
+
+unsigned long QUEUE_Size(QUEUE_Queue *queue)
+{
+	// the head is read first, so it cannot have passed the tail read after it
+	unsigned long head = atomic_load(&queue->head);
+	unsigned long tail = atomic_load(&queue->tail);
+	return tail - head;
+}
+
+void QUEUE_Destroy(POLY_Polymorphic item)
+{
+	QUEUE_Clear(QUEUE_POLYQUEUE(item));
+	free(QUEUE_POLYQUEUE(item));
+}
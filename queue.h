@@ -0,0 +1,102 @@
+/*
+Header file for bounded lock-free queue implementation
+
+Copyright (C) 2016 Kyle Gagner
+All Rights Reserved
+*/
+
+// for threads
+#include <pthread.h>
+// for atomics
+#include <stdatomic.h>
+// for polymorphism
+#include "poly.h"
+
+// include guard
+#ifndef QUEUE_H
+#define QUEUE_H
+
+// a definition for NULL may be needed
+#ifndef NULL
+#define NULL ((void*)0)
+#endif
+
+// alignment of the ends of a queue, the size of a cache line, so producers and consumers do not share lines
+#define QUEUE_ALIGNMENT 64
+
+// casting polymorphism
+#define QUEUE_POLYQUEUE(value) ((QUEUE_Queue*)value.ref)
+
+// represents a cell in the buffer of a queue
+// sequence is the position the cell is ready to be written at, or one more than the position it is ready to be read at
+typedef struct QUEUE_Cell
+{
+	_Atomic unsigned long sequence;
+	POLY_Polymorphic value;
+} QUEUE_Cell;
+
+// represents a bounded queue for any number of producing and consuming threads
+// tail and head are positions which only increase, the cell of a position is the position masked by the capacity less one
+// producers and consumers claim positions without locks, the lock is only taken by consumers waiting on an empty queue
+// and by producers waking them
+typedef struct QUEUE_Queue
+{
+	QUEUE_Cell *cells;
+	unsigned long capacity;
+	_Alignas(QUEUE_ALIGNMENT) _Atomic unsigned long tail;
+	_Alignas(QUEUE_ALIGNMENT) _Atomic unsigned long head;
+	_Alignas(QUEUE_ALIGNMENT) _Atomic unsigned long waiters;
+	_Atomic int closed;
+	pthread_mutex_t lock;
+	pthread_cond_t available;
+} QUEUE_Queue;
+
+// initialize a queue
+// takes a pointer to the queue to initialize and the most values it may hold, which is rounded up to a power of two
+// returns a pointer to the queue
+QUEUE_Queue *QUEUE_Initialize(QUEUE_Queue *queue, unsigned long capacity);
+
+// remove all items from a queue and free memory, no other thread may be using the queue
+// the queue must be initialized again before it is used again
+// takes a pointer to the queue
+void QUEUE_Clear(QUEUE_Queue *queue);
+
+// insert at the tail of a queue without waiting
+// takes a pointer to the queue and the value to insert
+// returns 1 if the value was inserted, 0 if the queue is full
+int QUEUE_InsertTail(QUEUE_Queue *queue, POLY_Polymorphic value);
+
+// insert several values at the tail of a queue without waiting, the values inserted are consecutive in the queue
+// takes a pointer to the queue, an array of values and the number of values in the array
+// returns the number of values inserted from the start of the array, fewer than given if the queue fills
+unsigned long QUEUE_InsertTailBatch(QUEUE_Queue *queue, POLY_Polymorphic *values, unsigned long count);
+
+// take a value from the head of a queue without waiting
+// takes a pointer to the queue and where to put the value
+// returns 1 if a value was taken, 0 if the queue is empty
+int QUEUE_TryTakeHead(QUEUE_Queue *queue, POLY_Polymorphic *value);
+
+// take a value from the head of a queue, waiting until there is one or the queue is closed
+// takes a pointer to the queue and where to put the value
+// returns 1 if a value was taken, 0 if the queue is closed and empty
+int QUEUE_TakeHead(QUEUE_Queue *queue, POLY_Polymorphic *value);
+
+// take several values from the head of a queue without waiting
+// takes a pointer to the queue, an array to put the values in and the size of the array
+// returns the number of values taken
+unsigned long QUEUE_TakeHeadBatch(QUEUE_Queue *queue, POLY_Polymorphic *values, unsigned long count);
+
+// closes a queue, waking every consumer waiting on it, values already inserted may still be taken
+// takes a pointer to the queue
+void QUEUE_Close(QUEUE_Queue *queue);
+
+// finds the size of a queue, which may be stale by the time it is used if other threads are using the queue
+// takes a pointer to the queue
+// returns the number of elements in the queue
+unsigned long QUEUE_Size(QUEUE_Queue *queue);
+
+// a function to clear a queue and free the pointer to the queue
+// takes a pointer to the queue to destroy
+void QUEUE_Destroy(POLY_Polymorphic item);
+
+#endif
@@ -7,9 +7,16 @@ All Rights Reserved
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
 #include "regex.h"
 #include "avl.h"
-#include "list.h"
+#include "avlgen.h"
+#include "deque.h"
+#include "hash.h"
+#include "task.h"
+#include "mem.h"
 
 // INTERNAL MACROS
 
@@ -17,14 +24,29 @@ All Rights Reserved
 #define POLYDFA(value)   ((DFA_Node*)value.ref)
 #define POLYTOKEN(value) ((Token)value.integer)
 #define POLYFRAG(value)  ((NFA_Fragment*)value.ref)
+#define POLYTUPLE(value) ((DFA_Tuple*)value.ref)
+
+// number of independently locked partitions of the state set map used by parallel conversion
+#define SHARDS 64
+
+// the bit of an assertion's condition for a position between characters of two contexts
+#define BOUNDARY(previous, next) ((previous)*REGEX_CONTEXTS + (next))
+
+// a boundary at which no assertion is followed
+#define NO_BOUNDARY -1
 
 // INTERNAL TYPES
 
 // represents a single node in a nondeterministic finite state automaton
+// the epsilons of an assertion are only followed at boundaries whose bits are set in its condition, 0 for other nodes
+// a marker has no edges and stands in a set of NFA states for the context of the character before the set was reached,
+// context is -1 for nodes which are not markers
 typedef struct NFA_Node
 {
 	AVL_Tree transitions;
 	AVL_Tree epsilons;
+	unsigned short condition;
+	int context;
 	unsigned long accepts;
 	unsigned long identifier;
 	struct NFA_Node *next;
@@ -35,13 +57,57 @@ typedef struct DFA_Node
 {
 	AVL_Tree transitions;
 	unsigned long accepts;
+	unsigned long *conditional;
 	unsigned long identifier;
 	struct DFA_Node *next;
-	AVL_Tree *children;
 	struct DFA_Node *parent;
 	struct DFA_Node *surrogate;
 } DFA_Node;
 
+// represents the work shared between threads in parallel conversion
+typedef struct Determinizer
+{
+	HASH_Table maps[SHARDS];
+	pthread_mutex_t maplocks[SHARDS];
+	pthread_mutex_t chainlock;
+	NFA_Node **markers;
+	unsigned long *unique;
+	DFA_Node **last;
+	struct Worker *workers;
+	unsigned int workers_count;
+	pthread_mutex_t idlelock;
+	pthread_cond_t idle;
+	unsigned long available;
+	unsigned long pending;
+	unsigned long allocations;
+} Determinizer;
+
+// represents a thread in parallel conversion with its own queue of unexplored state sets
+typedef struct Worker
+{
+	DEQUE_Deque unexplored;
+	pthread_mutex_t lock;
+	Determinizer *shared;
+	unsigned int index;
+	pthread_t thread;
+} Worker;
+
+// represents a state of the union of several DFAs as the states each DFA is in, NULL where a DFA has no state
+typedef struct
+{
+	unsigned long parts_count;
+	DFA_Node **parts;
+} DFA_Tuple;
+
+// represents a range of expressions compiled to a DFA independently of the others
+typedef struct
+{
+	REGEX_Expression *expressions;
+	unsigned long expressions_count;
+	DFA_Node *starts[REGEX_CONTEXTS];
+	REGEX_Stats stats;
+} Group;
+
 // represents a regex token
 typedef enum
 {
@@ -72,12 +138,28 @@ int NFA_Comparator(POLY_Polymorphic key1, POLY_Polymorphic key2)
 	return 0;
 }
 
+// comparison of NFA states by identifier, agreeing with NFA_Comparator
+#define NFA_COMPARE(key1, key2) AVL_COMPARE_VALUES(POLYNFA(key1)->identifier, POLYNFA(key2)->identifier)
+
+// operations on sets of NFA states and on maps keyed by symbol with their comparisons inlined, for the hot loops of conversion
+AVL_SPECIALIZE(NFA_Set, NFA_COMPARE)
+AVL_SPECIALIZE(SymbolMap, AVL_COMPARE_UINT16)
+
+// frees a set allocated for the compiler, as AVL_Destroy does but accounting for it as a set
+void DestroySet(POLY_Polymorphic item)
+{
+	AVL_Clear(AVL_POLYTREE(item));
+	MEM_RELEASE(MEM_SETS, AVL_POLYTREE(item), sizeof(AVL_Tree));
+}
+
 // creates a uniquely numbered NFA node
 NFA_Node *NFA_CreateState(unsigned long *unique, NFA_Node **last)
 {
-	NFA_Node *node = malloc(sizeof(NFA_Node));
-	AVL_Initialize(&node->transitions, NULL, AVL_Destroy, UNICODE_CharComparator);
+	NFA_Node *node = MEM_ALLOCATE(MEM_NFA, sizeof(NFA_Node));
+	AVL_Initialize(&node->transitions, NULL, DestroySet, UNICODE_CharComparator);
 	AVL_Initialize(&node->epsilons, NULL, NULL, NFA_Comparator);
+	node->condition = 0;
+	node->context = -1;
 	node->accepts = 0;
 	node->identifier = (*unique)++;
 	node->next = NULL;
@@ -86,6 +168,19 @@ NFA_Node *NFA_CreateState(unsigned long *unique, NFA_Node **last)
 	return node;
 }
 
+// frees an NFA chain, the sets its transitions reach are freed with it
+void NFA_DestroyChain(NFA_Node *first)
+{
+	while(first)
+	{
+		NFA_Node *next = first->next;
+		AVL_Clear(&first->transitions);
+		AVL_Clear(&first->epsilons);
+		MEM_RELEASE(MEM_NFA, first, sizeof(NFA_Node));
+		first = next;
+	}
+}
+
 // comparator for DFA
 int DFA_Comparator(POLY_Polymorphic key1, POLY_Polymorphic key2)
 {
@@ -99,24 +194,53 @@ int DFA_Comparator(POLY_Polymorphic key1, POLY_Polymorphic key2)
 // creates a uniquely numbered DFA node
 DFA_Node *DFA_CreateState(unsigned long *unique, DFA_Node **last)
 {
-	DFA_Node *node = malloc(sizeof(DFA_Node));
+	DFA_Node *node = MEM_ALLOCATE(MEM_DFA, sizeof(DFA_Node));
 	AVL_Initialize(&node->transitions, NULL, NULL, UNICODE_CharComparator); // DESTROYER?
+	node->conditional = NULL;
 	node->parent = NULL;
 	node->identifier = (*unique)++;
 	node->next = NULL;
 	if(*last) (*last)->next = node;
 	*last = node;
-	node->children = NULL;
 	return node;
 }
 
-// comparator for DFA nodes used for binning nodes by their connection topology in state simplification
+// frees a DFA chain
+void DFA_DestroyChain(DFA_Node *first)
+{
+	while(first)
+	{
+		DFA_Node *next = first->next;
+		AVL_Clear(&first->transitions);
+		if(first->conditional) MEM_RELEASE(MEM_DFA, first->conditional, sizeof(unsigned long)*REGEX_CONTEXTS);
+		MEM_RELEASE(MEM_DFA, first, sizeof(DFA_Node));
+		first = next;
+	}
+}
+
+// comparator for DFA nodes used for binning nodes in state simplification, by what they accept, the symbols they have
+// transitions on, and the bins they and the states their transitions reach were in after the previous round of refinement
 int DFA_BinComparator(POLY_Polymorphic key1, POLY_Polymorphic key2)
 {
 	unsigned long a1 = POLYDFA(key1)->accepts;
 	unsigned long a2 = POLYDFA(key2)->accepts;
 	if(a1 < a2) return -1;
 	if(a1 > a2) return 1;
+	unsigned long *c1 = POLYDFA(key1)->conditional;
+	unsigned long *c2 = POLYDFA(key2)->conditional;
+	if(!c1 != !c2) return c1 ? 1 : -1;
+	if(c1)
+	{
+		for(int n = 0; n < REGEX_CONTEXTS; n++)
+		{
+			if(c1[n] < c2[n]) return -1;
+			if(c1[n] > c2[n]) return 1;
+		}
+	}
+	unsigned long b1 = POLYDFA(key1)->surrogate->identifier;
+	unsigned long b2 = POLYDFA(key2)->surrogate->identifier;
+	if(b1 < b2) return -1;
+	if(b1 > b2) return 1;
 	AVL_Tree *t1 = &POLYDFA(key1)->transitions;
 	AVL_Tree *t2 = &POLYDFA(key2)->transitions;
 	unsigned long s1 = AVL_Size(t1);
@@ -132,13 +256,10 @@ int DFA_BinComparator(POLY_Polymorphic key1, POLY_Polymorphic key2)
 		UNICODE_Char k2 = UNICODE_POLYCHAR(AVL_Key(&iter2));
 		if(k1 < k2) return -1;
 		if(k1 > k2) return 1;
-		if(POLYDFA(AVL_Value(&iter1))->parent && POLYDFA(AVL_Value(&iter2))->parent) //???
-		{
-			int v1 = POLYDFA(AVL_Value(&iter1))->parent->identifier;
-			int v2 = POLYDFA(AVL_Value(&iter2))->parent->identifier;
-			if(v1 < v2) return -1;
-			if(v1 > v2) return 1;
-		}
+		unsigned long v1 = POLYDFA(AVL_Value(&iter1))->surrogate->identifier;
+		unsigned long v2 = POLYDFA(AVL_Value(&iter2))->surrogate->identifier;
+		if(v1 < v2) return -1;
+		if(v1 > v2) return 1;
 	}
 	return 0;
 }
@@ -157,87 +278,167 @@ unsigned long GetAccepts(AVL_Tree *states)
 	return accepts;
 }
 
-// finds the mapping from a set of NFA states to a DFA state, or creates the mapping if it doesn't exist and queues unexplored states
-DFA_Node *MapStates(AVL_Tree *map, AVL_Tree *states, unsigned long *unique, DFA_Node **last, LIST_List *unexplored)
+// finds the epsilon closure of a set of states, following the epsilons of assertions which hold at a boundary
+// takes the set and the boundary, NO_BOUNDARY to follow no assertion
+AVL_Tree *EpsilonClosure(AVL_Tree *states, int boundary)
 {
-	if(AVL_Contains(map, POLY_REF(states)))
-		return POLYDFA(AVL_Get(map, POLY_REF(states)));
-	else
-	{
-		DFA_Node *node;
-		AVL_Set(map, POLY_REF(states), POLY_REF(node = DFA_CreateState(unique, last)));
-		LIST_InsertHead(unexplored, POLY_REF(states));
-		node->accepts = GetAccepts(states);
-		return node;
-	}
-}
-
-// finds the epsilon closure of a set of states
-AVL_Tree *EpsilonClosure(AVL_Tree *states)
-{
-	AVL_Tree *result = AVL_Initialize(malloc(sizeof(AVL_Tree)), NULL, NULL, NFA_Comparator);
-	AVL_Iterator iter;
-	AVL_InitializeIterator(states, &iter);
-	while(AVL_Next(&iter)) AVL_Insert(result, AVL_Key(&iter));
+	AVL_Tree *result = AVL_Copy(MEM_ALLOCATE(MEM_SETS, sizeof(AVL_Tree)), states, NULL, NULL);
 	AVL_Tree *frontier = states;
 	int intermediate = 0;
 	while(AVL_Size(frontier))
 	{
-		AVL_Tree *next = AVL_Initialize(malloc(sizeof(AVL_Tree)), NULL, NULL, NFA_Comparator);
+		AVL_Tree *next = AVL_Initialize(MEM_ALLOCATE(MEM_SETS, sizeof(AVL_Tree)), NULL, NULL, NFA_Comparator);
 		AVL_Iterator outer;
 		AVL_InitializeIterator(frontier, &outer);
 		while(AVL_Next(&outer))
 		{
+			NFA_Node *node = POLYNFA(AVL_Key(&outer));
+			if(node->condition && (boundary == NO_BOUNDARY || !(node->condition >> boundary & 1))) continue;
 			AVL_Iterator inner;
-			AVL_InitializeIterator(&POLYNFA(AVL_Key(&outer))->epsilons, &inner);
+			AVL_InitializeIterator(&node->epsilons, &inner);
 			while(AVL_Next(&inner))
 			{
-				if(!AVL_Contains(result, AVL_Key(&inner)))
+				if(!NFA_SetContains(result, AVL_Key(&inner)))
 				{
-					AVL_Insert(result, AVL_Key(&inner));
-					AVL_Insert(next, AVL_Key(&inner));
+					NFA_SetInsert(result, AVL_Key(&inner));
+					NFA_SetInsert(next, AVL_Key(&inner));
 				}
 			}
 		}
 		if(intermediate)
 		{
 			AVL_Clear(frontier);
-			free(frontier);
+			MEM_RELEASE(MEM_SETS, frontier, sizeof(AVL_Tree));
 		}
 		intermediate = 1;
 		frontier = next;
 	}
+	// the last frontier is empty
+	if(intermediate) DestroySet(POLY_REF(frontier));
 	return result;
 }
 
+// finds whether a set of NFA states holds an assertion, in which case what it does next depends on the context
+int HasConditions(AVL_Tree *states)
+{
+	AVL_Iterator iter;
+	AVL_InitializeIterator(states, &iter);
+	while(AVL_Next(&iter)) if(POLYNFA(AVL_Key(&iter))->condition) return 1;
+	return 0;
+}
+
+// finds the context of the character before a set of NFA states was reached
+// returns the context of the set's marker, or -1 if the set has none since it holds no assertion
+int PreviousContext(AVL_Tree *states)
+{
+	AVL_Iterator iter;
+	AVL_InitializeIterator(states, &iter);
+	while(AVL_Next(&iter)) if(POLYNFA(AVL_Key(&iter))->context >= 0) return POLYNFA(AVL_Key(&iter))->context;
+	return -1;
+}
+
+// sets the accepts values of the DFA state a set of NFA states maps to
+// a set holding assertions may accept with more once they are followed, which depends on the context of the next character
+// takes the DFA state, the set and the markers, NULL if the NFA has no assertions
+void SetAccepts(DFA_Node *node, AVL_Tree *states, NFA_Node **markers)
+{
+	node->accepts = GetAccepts(states);
+	int previous = markers ? PreviousContext(states) : -1;
+	if(previous < 0) return;
+	unsigned long conditional[REGEX_CONTEXTS];
+	int differs = 0;
+	for(int next = 0; next < REGEX_CONTEXTS; next++)
+	{
+		AVL_Tree *closure = EpsilonClosure(states, BOUNDARY(previous, next));
+		conditional[next] = GetAccepts(closure);
+		DestroySet(POLY_REF(closure));
+		if(conditional[next] != node->accepts) differs = 1;
+	}
+	if(!differs) return;
+	node->conditional = MEM_ALLOCATE(MEM_DFA, sizeof(unsigned long)*REGEX_CONTEXTS);
+	memcpy(node->conditional, conditional, sizeof(unsigned long)*REGEX_CONTEXTS);
+}
+
+// hasher for sets of NFA states, consistent with NFA_SetDeepComparator
+unsigned long long NFA_SetHasher(POLY_Polymorphic key)
+{
+	unsigned long long hash = AVL_Size(AVL_POLYTREE(key));
+	AVL_Iterator iter;
+	AVL_InitializeIterator(AVL_POLYTREE(key), &iter);
+	while(AVL_Next(&iter)) hash = HASH_Mix(hash + POLYNFA(AVL_Key(&iter))->identifier);
+	return hash;
+}
+
+// equality test for sets of NFA states
+int NFA_SetEquality(POLY_Polymorphic key1, POLY_Polymorphic key2)
+{
+	return !NFA_SetDeepComparator(key1, key2);
+}
+
+// finds the mapping from a set of NFA states to a DFA state, or creates the mapping if it doesn't exist and queues unexplored states
+// the map takes ownership of the set, which is destroyed if an equal set is already mapped
+DFA_Node *MapStates(HASH_Table *map, AVL_Tree *states, NFA_Node **markers, unsigned long *unique, DFA_Node **last, DEQUE_Deque *unexplored)
+{
+	DFA_Node *node = POLYDFA(HASH_Get(map, POLY_REF(states)));
+	if(node)
+	{
+		DestroySet(POLY_REF(states));
+		return node;
+	}
+	else
+	{
+		HASH_Set(map, POLY_REF(states), POLY_REF(node = DFA_CreateState(unique, last)));
+		DEQUE_InsertHead(unexplored, POLY_REF(states));
+		SetAccepts(node, states, markers);
+		return node;
+	}
+}
+
 // using the epsilon closure, find all mappings from transitions to the set of states they may reach
-AVL_Tree *TransitionSets(AVL_Tree *states)
+// a set holding assertions follows them on each transition as they hold between the previous character and the character of
+// the transition, and the sets reached are marked with the context of that character if they hold assertions
+// takes the set and the markers, NULL if the NFA has no assertions
+AVL_Tree *TransitionSets(AVL_Tree *states, NFA_Node **markers)
 {
 	AVL_Tree intermediate;
-	AVL_Initialize(&intermediate, NULL, NULL, UNICODE_CharComparator);
-	AVL_Iterator outer;
-	// WORK IN PROGRESS WITH EPSILON CLOSURE HERE
-	AVL_InitializeIterator(EpsilonClosure(states), &outer);
-	while(AVL_Next(&outer))
+	AVL_Initialize(&intermediate, NULL, DestroySet, UNICODE_CharComparator);
+	int previous = markers ? PreviousContext(states) : -1;
+	// characters are never of the context REGEX_TEXT, and without assertions every context has the same closure
+	for(int next = previous < 0 ? REGEX_OTHER : REGEX_LINE; next < REGEX_CONTEXTS; next++)
 	{
-		AVL_Iterator inner;
-		AVL_InitializeIterator(&POLYNFA(AVL_Key(&outer))->transitions, &inner);
-		while(AVL_Next(&inner))
+		AVL_Tree *closure = EpsilonClosure(states, previous < 0 ? NO_BOUNDARY : BOUNDARY(previous, next));
+		AVL_Iterator outer;
+		AVL_InitializeIterator(closure, &outer);
+		while(AVL_Next(&outer))
 		{
-			AVL_Tree *set;
-			if(AVL_Contains(&intermediate, AVL_Key(&inner)))
-				set = AVL_POLYTREE(AVL_Get(&intermediate, AVL_Key(&inner)));
-			else
-				AVL_Set(&intermediate, AVL_Key(&inner), POLY_REF(set = AVL_Initialize(malloc(sizeof(AVL_Tree)), NULL, NULL, NFA_Comparator)));
-			AVL_Iterator sub;
-			AVL_InitializeIterator(AVL_POLYTREE(AVL_Value(&inner)), &sub);
-			while(AVL_Next(&sub)) AVL_Insert(set, AVL_Key(&sub));
+			AVL_Iterator inner;
+			AVL_InitializeIterator(&POLYNFA(AVL_Key(&outer))->transitions, &inner);
+			while(AVL_Next(&inner))
+			{
+				if(previous >= 0 && REGEX_Context(UNICODE_POLYCHAR(AVL_Key(&inner))) != next) continue;
+				AVL_Tree *set = AVL_POLYTREE(SymbolMapGet(&intermediate, AVL_Key(&inner)));
+				if(!set)
+					SymbolMapSet(&intermediate, AVL_Key(&inner), POLY_REF(set = AVL_Initialize(MEM_ALLOCATE(MEM_SETS, sizeof(AVL_Tree)), NULL, NULL, NFA_Comparator)));
+				AVL_Union(set, AVL_POLYTREE(AVL_Value(&inner)));
+			}
 		}
+		DestroySet(POLY_REF(closure));
 	}
-	AVL_Tree *result = AVL_Initialize(malloc(sizeof(AVL_Tree)), NULL, NULL, UNICODE_CharComparator);
+	AVL_Iterator outer;
+	unsigned long count = AVL_Size(&intermediate);
+	POLY_Polymorphic *keys = malloc(sizeof(POLY_Polymorphic)*count);
+	POLY_Polymorphic *values = malloc(sizeof(POLY_Polymorphic)*count);
 	AVL_InitializeIterator(&intermediate, &outer);
-	while(AVL_Next(&outer)) AVL_Set(result, AVL_Key(&outer), POLY_REF(EpsilonClosure(AVL_POLYTREE(AVL_Value(&outer)))));
-	// YOU NEED TO FREE SETS IN INTERMEDIATE?
+	for(unsigned long i = 0; AVL_Next(&outer); i++)
+	{
+		keys[i] = AVL_Key(&outer);
+		AVL_Tree *closure = EpsilonClosure(AVL_POLYTREE(AVL_Value(&outer)), NO_BOUNDARY);
+		if(markers && HasConditions(closure)) NFA_SetInsert(closure, POLY_REF(markers[REGEX_Context(UNICODE_POLYCHAR(keys[i]))]));
+		values[i] = POLY_REF(closure);
+	}
+	AVL_Tree *result = AVL_InitializeSorted(MEM_ALLOCATE(MEM_SETS, sizeof(AVL_Tree)), NULL, NULL, UNICODE_CharComparator, keys, values, count);
+	free(keys);
+	free(values);
 	AVL_Clear(&intermediate);
 	return result;
 }
@@ -299,56 +500,356 @@ void DFA_Debug(DFA_Node *start, char *name)
 	fclose(fp);
 }
 
-// converts an NFA to a DFA
-DFA_Node* Convert(NFA_Node *start, unsigned long *unique, DFA_Node **last)
+// measures the sets of NFA states in a map from sets to DFA states
+void MeasureSubsets(HASH_Table *map, REGEX_Stats *stats)
 {
-	AVL_Tree *initial = malloc(sizeof(AVL_Tree));
-	AVL_Initialize(initial, NULL, NULL, NFA_Comparator);
+	HASH_Iterator iter;
+	HASH_InitializeIterator(map, &iter);
+	while(HASH_Next(&iter))
+	{
+		unsigned long size = AVL_Size(AVL_POLYTREE(HASH_Key(&iter)));
+		stats->subset_states += size;
+		if(size > stats->subset_largest) stats->subset_largest = size;
+	}
+}
+
+// finds the sets of NFA states a DFA starts in, one for each context of the character before the start
+// takes the start of the NFA, the markers, NULL if the NFA has no assertions, and an array of a set for each context
+// returns the number of sets, which is 1 if the start holds no assertion since the context does not matter then
+int StartSets(NFA_Node *start, NFA_Node **markers, AVL_Tree **sets)
+{
+	AVL_Tree *initial = AVL_Initialize(MEM_ALLOCATE(MEM_SETS, sizeof(AVL_Tree)), NULL, NULL, NFA_Comparator);
 	AVL_Insert(initial, POLY_REF(start));
-	AVL_Tree *closure = EpsilonClosure(initial); // EPSILON CLOSURE BEHAVIOR CHANGED TO NOT FREE, ACTION NEEDED?
-	//AVL_Clear(initial); LOOK AT THIS LINE
-	LIST_List unexplored;
-	LIST_Initialize(&unexplored);
-	AVL_Tree map;
-	AVL_Initialize(&map, AVL_Destroy, NULL, AVL_DeepComparator);
-	DFA_Node *first = MapStates(&map, closure, unique, last, &unexplored);
-	while(LIST_Size(&unexplored))
-	{
-		AVL_Tree *states = AVL_POLYTREE(LIST_TakeTail(&unexplored));
-		DFA_Node *node = MapStates(&map, states, unique, last, &unexplored);
-		AVL_Tree *transitions = TransitionSets(states);
+	sets[0] = EpsilonClosure(initial, NO_BOUNDARY);
+	DestroySet(POLY_REF(initial));
+	if(!markers || !HasConditions(sets[0])) return 1;
+	for(int context = 1; context < REGEX_CONTEXTS; context++)
+	{
+		sets[context] = AVL_Copy(MEM_ALLOCATE(MEM_SETS, sizeof(AVL_Tree)), sets[0], NULL, NULL);
+		NFA_SetInsert(sets[context], POLY_REF(markers[context]));
+	}
+	NFA_SetInsert(sets[0], POLY_REF(markers[0]));
+	return REGEX_CONTEXTS;
+}
+
+// converts an NFA to a DFA, filling in the state the DFA starts in for each context
+// returns the first state of the chain, the start for REGEX_TEXT
+DFA_Node* Convert(NFA_Node *start, NFA_Node **markers, unsigned long *unique, DFA_Node **last, REGEX_Stats *stats, DFA_Node **starts)
+{
+	AVL_Tree *initial[REGEX_CONTEXTS];
+	int initial_count = StartSets(start, markers, initial);
+	DEQUE_Deque unexplored;
+	DEQUE_Initialize(&unexplored);
+	HASH_Table map;
+	HASH_Initialize(&map, DestroySet, NULL, NFA_SetHasher, NFA_SetEquality);
+	for(int context = 0; context < REGEX_CONTEXTS; context++)
+		starts[context] = context < initial_count ? MapStates(&map, initial[context], markers, unique, last, &unexplored) : starts[0];
+	while(DEQUE_Size(&unexplored))
+	{
+		AVL_Tree *states = AVL_POLYTREE(DEQUE_TakeTail(&unexplored));
+		DFA_Node *node = POLYDFA(HASH_Get(&map, POLY_REF(states)));
+		AVL_Tree *transitions = TransitionSets(states, markers);
 		AVL_Iterator iter;
 		AVL_InitializeIterator(transitions, &iter);
 		while(AVL_Next(&iter))
-			AVL_Set(&node->transitions, AVL_Key(&iter), POLY_REF(MapStates(&map, AVL_POLYTREE(AVL_Value(&iter)), unique, last, &unexplored)));
+			SymbolMapSet(&node->transitions, AVL_Key(&iter), POLY_REF(MapStates(&map, AVL_POLYTREE(AVL_Value(&iter)), markers, unique, last, &unexplored)));
 		AVL_Clear(transitions);
-		free(transitions);
+		MEM_RELEASE(MEM_SETS, transitions, sizeof(AVL_Tree));
 	}
-	return first;
+	DEQUE_Clear(&unexplored);
+	MeasureSubsets(&map, stats);
+	HASH_Clear(&map);
+	return starts[0];
+}
+
+// orders a DFA chain and numbers its states breadth first from the start states, visiting transitions in order
+// this is the order in which Convert discovers states, so a parallel conversion yields the same machine as a serial one
+DFA_Node *CanonicalOrder(DFA_Node **starts, unsigned long *unique, DFA_Node **last)
+{
+	AVL_Tree visited;
+	AVL_Initialize(&visited, NULL, NULL, DFA_Comparator);
+	DEQUE_Deque queue;
+	DEQUE_Initialize(&queue);
+	DEQUE_Deque order;
+	DEQUE_Initialize(&order);
+	for(int context = 0; context < REGEX_CONTEXTS; context++)
+	{
+		if(AVL_Contains(&visited, POLY_REF(starts[context]))) continue;
+		AVL_Insert(&visited, POLY_REF(starts[context]));
+		DEQUE_InsertTail(&queue, POLY_REF(starts[context]));
+	}
+	while(DEQUE_Size(&queue))
+	{
+		DFA_Node *node = POLYDFA(DEQUE_TakeHead(&queue));
+		DEQUE_InsertTail(&order, POLY_REF(node));
+		AVL_Iterator iter;
+		AVL_InitializeIterator(&node->transitions, &iter);
+		while(AVL_Next(&iter))
+		{
+			if(!AVL_Contains(&visited, AVL_Value(&iter)))
+			{
+				AVL_Insert(&visited, AVL_Value(&iter));
+				DEQUE_InsertTail(&queue, AVL_Value(&iter));
+			}
+		}
+	}
+	AVL_Clear(&visited);
+	DEQUE_Clear(&queue);
+	*unique = 0;
+	*last = NULL;
+	while(DEQUE_Size(&order))
+	{
+		DFA_Node *node = POLYDFA(DEQUE_TakeHead(&order));
+		node->identifier = (*unique)++;
+		node->next = NULL;
+		if(*last) (*last)->next = node;
+		*last = node;
+	}
+	DEQUE_Clear(&order);
+	return starts[0];
+}
+
+// picks the partition of the state set map responsible for a set of NFA states
+// the high bits of the hash are used, the low bits place the set within the partition
+unsigned int ShardStates(AVL_Tree *states)
+{
+	return (NFA_SetHasher(POLY_REF(states)) >> 32) % SHARDS;
+}
+
+// queues a set of NFA states on a worker's queue and wakes an idle worker
+// the set is counted under the idle lock as it is published, so a worker stealing it cannot count it explored first
+void QueueStates(Worker *worker, AVL_Tree *states)
+{
+	Determinizer *shared = worker->shared;
+	pthread_mutex_lock(&shared->idlelock);
+	pthread_mutex_lock(&worker->lock);
+	DEQUE_InsertHead(&worker->unexplored, POLY_REF(states));
+	pthread_mutex_unlock(&worker->lock);
+	shared->available++;
+	shared->pending++;
+	pthread_cond_signal(&shared->idle);
+	pthread_mutex_unlock(&shared->idlelock);
+}
+
+// thread safe version of MapStates, newly mapped sets are queued on the calling worker and duplicate sets are destroyed
+DFA_Node *MapStatesShared(Worker *worker, AVL_Tree *states)
+{
+	Determinizer *shared = worker->shared;
+	unsigned int shard = ShardStates(states);
+	DFA_Node *node;
+	int created = 0;
+	pthread_mutex_lock(&shared->maplocks[shard]);
+	node = POLYDFA(HASH_Get(&shared->maps[shard], POLY_REF(states)));
+	if(!node)
+	{
+		pthread_mutex_lock(&shared->chainlock);
+		node = DFA_CreateState(shared->unique, shared->last);
+		pthread_mutex_unlock(&shared->chainlock);
+		SetAccepts(node, states, shared->markers);
+		HASH_Set(&shared->maps[shard], POLY_REF(states), POLY_REF(node));
+		created = 1;
+	}
+	pthread_mutex_unlock(&shared->maplocks[shard]);
+	if(created) QueueStates(worker, states);
+	else DestroySet(POLY_REF(states));
+	return node;
+}
+
+// takes an unexplored set of NFA states from the worker's own queue, or steals one from the tail of another worker's queue
+// returns NULL if all queues were empty
+AVL_Tree *TakeStates(Worker *worker)
+{
+	Determinizer *shared = worker->shared;
+	AVL_Tree *states = NULL;
+	for(unsigned int n = 0; n < shared->workers_count && !states; n++)
+	{
+		Worker *victim = &shared->workers[(worker->index + n) % shared->workers_count];
+		pthread_mutex_lock(&victim->lock);
+		if(DEQUE_Size(&victim->unexplored))
+		{
+			if(victim == worker) states = AVL_POLYTREE(DEQUE_TakeHead(&victim->unexplored));
+			else states = AVL_POLYTREE(DEQUE_TakeTail(&victim->unexplored));
+		}
+		pthread_mutex_unlock(&victim->lock);
+	}
+	if(states)
+	{
+		pthread_mutex_lock(&shared->idlelock);
+		shared->available--;
+		pthread_mutex_unlock(&shared->idlelock);
+	}
+	return states;
+}
+
+// explores unexplored sets of NFA states until every queue is empty and no worker is still exploring
+void *ExploreStates(void *argument)
+{
+	Worker *worker = argument;
+	Determinizer *shared = worker->shared;
+	unsigned long allocations = AVL_Allocations();
+	while(1)
+	{
+		pthread_mutex_lock(&shared->idlelock);
+		while(!shared->available && shared->pending) pthread_cond_wait(&shared->idle, &shared->idlelock);
+		int done = !shared->pending;
+		pthread_mutex_unlock(&shared->idlelock);
+		if(done) break;
+		AVL_Tree *states = TakeStates(worker);
+		if(!states) continue;
+		unsigned int shard = ShardStates(states);
+		pthread_mutex_lock(&shared->maplocks[shard]);
+		DFA_Node *node = POLYDFA(HASH_Get(&shared->maps[shard], POLY_REF(states)));
+		pthread_mutex_unlock(&shared->maplocks[shard]);
+		AVL_Tree *transitions = TransitionSets(states, shared->markers);
+		AVL_Iterator iter;
+		AVL_InitializeIterator(transitions, &iter);
+		while(AVL_Next(&iter))
+			SymbolMapSet(&node->transitions, AVL_Key(&iter), POLY_REF(MapStatesShared(worker, AVL_POLYTREE(AVL_Value(&iter)))));
+		AVL_Clear(transitions);
+		MEM_RELEASE(MEM_SETS, transitions, sizeof(AVL_Tree));
+		pthread_mutex_lock(&shared->idlelock);
+		if(!--shared->pending) pthread_cond_broadcast(&shared->idle);
+		pthread_mutex_unlock(&shared->idlelock);
+	}
+	pthread_mutex_lock(&shared->idlelock);
+	shared->allocations += AVL_Allocations() - allocations;
+	pthread_mutex_unlock(&shared->idlelock);
+	return NULL;
+}
+
+// converts an NFA to a DFA using several threads, the resulting chain is ordered as Convert would order it
+DFA_Node *ConvertParallel(NFA_Node *start, NFA_Node **markers, unsigned long *unique, DFA_Node **last, unsigned int threads, REGEX_Stats *stats, DFA_Node **starts)
+{
+	Determinizer shared;
+	for(unsigned int n = 0; n < SHARDS; n++)
+	{
+		HASH_Initialize(&shared.maps[n], DestroySet, NULL, NFA_SetHasher, NFA_SetEquality);
+		pthread_mutex_init(&shared.maplocks[n], NULL);
+	}
+	pthread_mutex_init(&shared.chainlock, NULL);
+	pthread_mutex_init(&shared.idlelock, NULL);
+	pthread_cond_init(&shared.idle, NULL);
+	shared.markers = markers;
+	shared.unique = unique;
+	shared.last = last;
+	shared.available = 0;
+	shared.pending = 0;
+	shared.allocations = 0;
+	shared.workers_count = threads;
+	shared.workers = malloc(sizeof(Worker)*threads);
+	for(unsigned int n = 0; n < threads; n++)
+	{
+		DEQUE_Initialize(&shared.workers[n].unexplored);
+		pthread_mutex_init(&shared.workers[n].lock, NULL);
+		shared.workers[n].shared = &shared;
+		shared.workers[n].index = n;
+	}
+	AVL_Tree *initial[REGEX_CONTEXTS];
+	int initial_count = StartSets(start, markers, initial);
+	for(int context = 0; context < REGEX_CONTEXTS; context++)
+		starts[context] = context < initial_count ? MapStatesShared(&shared.workers[0], initial[context]) : starts[0];
+	for(unsigned int n = 0; n < threads; n++)
+		pthread_create(&shared.workers[n].thread, NULL, ExploreStates, &shared.workers[n]);
+	for(unsigned int n = 0; n < threads; n++)
+	{
+		pthread_join(shared.workers[n].thread, NULL);
+		pthread_mutex_destroy(&shared.workers[n].lock);
+		DEQUE_Clear(&shared.workers[n].unexplored);
+	}
+	free(shared.workers);
+	stats->avl_allocations += shared.allocations;
+	for(unsigned int n = 0; n < SHARDS; n++)
+	{
+		MeasureSubsets(&shared.maps[n], stats);
+		HASH_Clear(&shared.maps[n]);
+		pthread_mutex_destroy(&shared.maplocks[n]);
+	}
+	pthread_mutex_destroy(&shared.chainlock);
+	pthread_mutex_destroy(&shared.idlelock);
+	pthread_cond_destroy(&shared.idle);
+	return CanonicalOrder(starts, unique, last);
 }
 
 // pushes nfa fragment to stack representing transition
-void ConstructTransition(unsigned long *unique, NFA_Node **last, UNICODE_Char c, LIST_List *stack)
+// when folding, the fragment has a transition on every character of the simple case fold orbit of the character,
+// so ignoring case adds no states
+void ConstructTransition(unsigned long *unique, NFA_Node **last, UNICODE_Char c, int fold, DEQUE_Deque *stack)
 {
 	NFA_Fragment *fragment = malloc(sizeof(NFA_Fragment));
 	fragment->start = NFA_CreateState(unique, last);
 	fragment->end = NFA_CreateState(unique, last);
-	// CHECK FOR MEMORY LEAKS LATER:
-	AVL_Tree *set = AVL_Initialize(malloc(sizeof(AVL_Tree)), NULL, NULL, NFA_Comparator);
-	AVL_Insert(set, POLY_REF(fragment->end));
-	AVL_Set(&fragment->start->transitions, UNICODE_CHARPOLY(c), POLY_REF(set));	
-	LIST_InsertHead(stack, POLY_REF(fragment));
+	UNICODE_Char member = c;
+	do
+	{
+		AVL_Tree *set = AVL_Initialize(MEM_ALLOCATE(MEM_SETS, sizeof(AVL_Tree)), NULL, NULL, NFA_Comparator);
+		AVL_Insert(set, POLY_REF(fragment->end));
+		AVL_Set(&fragment->start->transitions, UNICODE_CHARPOLY(member), POLY_REF(set));
+		member = fold ? UNICODE_SimpleFold(member) : c;
+	}
+	while(member != c);
+	DEQUE_InsertHead(stack, POLY_REF(fragment));
+}
+
+// finds the condition of an assertion, the boundaries at which it holds
+// takes the character of the assertion, one of ^ $ A z b B
+unsigned short AssertionCondition(UNICODE_Char c)
+{
+	unsigned short condition = 0;
+	for(int previous = 0; previous < REGEX_CONTEXTS; previous++)
+	{
+		for(int next = 0; next < REGEX_CONTEXTS; next++)
+		{
+			int holds;
+			switch(c)
+			{
+				case '^':
+					holds = previous == REGEX_TEXT || previous == REGEX_LINE;
+					break;
+				case '$':
+					holds = next == REGEX_TEXT || next == REGEX_LINE;
+					break;
+				case 'A':
+					holds = previous == REGEX_TEXT;
+					break;
+				case 'z':
+					holds = next == REGEX_TEXT;
+					break;
+				case 'b':
+					holds = (previous == REGEX_WORD) != (next == REGEX_WORD);
+					break;
+				default:
+					holds = (previous == REGEX_WORD) == (next == REGEX_WORD);
+					break;
+			}
+			if(holds) condition |= 1 << BOUNDARY(previous, next);
+		}
+	}
+	return condition;
+}
+
+// pushes nfa fragment to stack representing an assertion
+// the assertion is a node between the start and end of the fragment, since operators may add epsilons to either
+void ConstructAssertion(unsigned long *unique, NFA_Node **last, UNICODE_Char c, DEQUE_Deque *stack)
+{
+	NFA_Fragment *fragment = malloc(sizeof(NFA_Fragment));
+	fragment->start = NFA_CreateState(unique, last);
+	NFA_Node *assertion = NFA_CreateState(unique, last);
+	fragment->end = NFA_CreateState(unique, last);
+	assertion->condition = AssertionCondition(c);
+	AVL_Insert(&fragment->start->epsilons, POLY_REF(assertion));
+	AVL_Insert(&assertion->epsilons, POLY_REF(fragment->end));
+	DEQUE_InsertHead(stack, POLY_REF(fragment));
 }
 
 // pops nfa fragments from stack and pushes result of combining on an operator
-void ConstructOperator(Token t, unsigned long *unique, NFA_Node **last, LIST_List *stack)
+void ConstructOperator(Token t, unsigned long *unique, NFA_Node **last, DEQUE_Deque *stack)
 {
 	switch(t)
 	{
 		case CONCATENATION:
 		{
-			NFA_Fragment *right = POLYFRAG(LIST_TakeHead(stack));
-			NFA_Fragment *left = POLYFRAG(LIST_PeekHead(stack));
+			NFA_Fragment *right = POLYFRAG(DEQUE_TakeHead(stack));
+			NFA_Fragment *left = POLYFRAG(DEQUE_PeekHead(stack));
 			AVL_Size(&left->end->epsilons);
 			AVL_Insert(&left->end->epsilons, POLY_REF(right->start));
 			AVL_Size(&left->end->epsilons);
@@ -358,8 +859,8 @@ void ConstructOperator(Token t, unsigned long *unique, NFA_Node **last, LIST_Lis
 		}
 		case ALTERNATION:
 		{
-			NFA_Fragment *right = POLYFRAG(LIST_TakeHead(stack));
-			NFA_Fragment *left = POLYFRAG(LIST_PeekHead(stack));
+			NFA_Fragment *right = POLYFRAG(DEQUE_TakeHead(stack));
+			NFA_Fragment *left = POLYFRAG(DEQUE_PeekHead(stack));
 			NFA_Node *start = NFA_CreateState(unique, last);
 			NFA_Node *end = NFA_CreateState(unique, last);
 			AVL_Insert(&start->epsilons, POLY_REF(right->start));
@@ -369,11 +870,12 @@ void ConstructOperator(Token t, unsigned long *unique, NFA_Node **last, LIST_Lis
 			AVL_Insert(&left->end->epsilons, POLY_REF(end));
 			left->start = start;
 			left->end = end;
+			free(right);
 			break;
 		}
 		case KLEENE_STAR:
 		{
-			NFA_Fragment *left = POLYFRAG(LIST_PeekHead(stack));
+			NFA_Fragment *left = POLYFRAG(DEQUE_PeekHead(stack));
 			NFA_Node *node = NFA_CreateState(unique, last);
 			AVL_Insert(&node->epsilons, POLY_REF(left->start));
 			AVL_Insert(&left->end->epsilons, POLY_REF(node));
@@ -385,13 +887,13 @@ void ConstructOperator(Token t, unsigned long *unique, NFA_Node **last, LIST_Lis
 		}
 		case OPTION:
 		{
-			NFA_Fragment *left = POLYFRAG(LIST_PeekHead(stack));
+			NFA_Fragment *left = POLYFRAG(DEQUE_PeekHead(stack));
 			AVL_Insert(&left->start->epsilons, POLY_REF(left->end));
 			break;
 		}
 		case REPETITION:
 		{
-			NFA_Fragment *left = POLYFRAG(LIST_PeekHead(stack));
+			NFA_Fragment *left = POLYFRAG(DEQUE_PeekHead(stack));
 			NFA_Node *start = NFA_CreateState(unique, last);
 			NFA_Node *end = NFA_CreateState(unique, last);
 			AVL_Insert(&start->epsilons, POLY_REF(left->start));
@@ -425,21 +927,22 @@ int OperatorPrecedence(Token t)
 }
 
 // pops operators of equal or lesser precedence than a given token, then pushes that token (constructs nfa fragments)
-void PopThenPush(Token t, unsigned long *unique, NFA_Node **last, LIST_List *nfastack, LIST_List *tokenstack)
+void PopThenPush(Token t, unsigned long *unique, NFA_Node **last, DEQUE_Deque *nfastack, DEQUE_Deque *tokenstack)
 {
 	int precedence = OperatorPrecedence(t);
-	while(LIST_Size(tokenstack)&&OperatorPrecedence(POLYTOKEN(LIST_PeekHead(tokenstack))) >= precedence)
-		ConstructOperator(POLYTOKEN(LIST_TakeHead(tokenstack)), unique, last, nfastack);
-	LIST_InsertHead(tokenstack, POLY_INTEGER(t));
+	while(DEQUE_Size(tokenstack)&&OperatorPrecedence(POLYTOKEN(DEQUE_PeekHead(tokenstack))) >= precedence)
+		ConstructOperator(POLYTOKEN(DEQUE_TakeHead(tokenstack)), unique, last, nfastack);
+	DEQUE_InsertHead(tokenstack, POLY_INTEGER(t));
 }
 
 // uses the shunting yard algorithm to create an NFA from a regular expression
-NFA_Node *ConstructNFA(unsigned long *unique, NFA_Node **last, unsigned long accepts, UNICODE_Char *expression)
+NFA_Node *ConstructNFA(unsigned long *unique, NFA_Node **last, unsigned long accepts, unsigned int flags, UNICODE_Char *expression)
 {
-	LIST_List tokenstack;
-	LIST_Initialize(&tokenstack);
-	LIST_List nfastack;
-	LIST_Initialize(&nfastack);
+	int fold = (flags & REGEX_CASE_INSENSITIVE) != 0;
+	DEQUE_Deque tokenstack;
+	DEQUE_Initialize(&tokenstack);
+	DEQUE_Deque nfastack;
+	DEQUE_Initialize(&nfastack);
 	UNICODE_Char c;
 	int cat = 0;
 	while(c = *expression++)
@@ -449,12 +952,12 @@ NFA_Node *ConstructNFA(unsigned long *unique, NFA_Node **last, unsigned long acc
 		{
 			case '(':
 				if(cat) PopThenPush(CONCATENATION, unique, last, &nfastack, &tokenstack);
-				LIST_InsertHead(&tokenstack, POLY_INTEGER(LPAREN));
+				DEQUE_InsertHead(&tokenstack, POLY_INTEGER(LPAREN));
 				break;
 			case ')':
-				while(LIST_Size(&tokenstack) && POLYTOKEN(LIST_PeekHead(&tokenstack)) != LPAREN)
-					ConstructOperator(POLYTOKEN(LIST_TakeHead(&tokenstack)), unique, last, &nfastack);
-				LIST_TakeHead(&tokenstack);
+				while(DEQUE_Size(&tokenstack) && POLYTOKEN(DEQUE_PeekHead(&tokenstack)) != LPAREN)
+					ConstructOperator(POLYTOKEN(DEQUE_TakeHead(&tokenstack)), unique, last, &nfastack);
+				DEQUE_TakeHead(&tokenstack);
 				ncat = 1;
 				break;
 			case '.':
@@ -475,22 +978,32 @@ NFA_Node *ConstructNFA(unsigned long *unique, NFA_Node **last, unsigned long acc
 				PopThenPush(REPETITION, unique, last, &nfastack, &tokenstack);
 				ncat = 1;
 				break;
+			case '^':
+			case '$':
+				if(cat) PopThenPush(CONCATENATION, unique, last, &nfastack, &tokenstack);
+				ConstructAssertion(unique, last, c, &nfastack);
+				ncat = 1;
+				break;
 			case '\\':
 				if(cat) PopThenPush(CONCATENATION, unique, last, &nfastack, &tokenstack);
-				ConstructTransition(unique, last, *expression++, &nfastack);
+				c = *expression++;
+				if(c == 'A' || c == 'z' || c == 'b' || c == 'B') ConstructAssertion(unique, last, c, &nfastack);
+				else ConstructTransition(unique, last, c, fold, &nfastack);
 				ncat = 1;
 				break;
 			default:
 				if(cat) PopThenPush(CONCATENATION, unique, last, &nfastack, &tokenstack);
-				ConstructTransition(unique, last, c, &nfastack);
+				ConstructTransition(unique, last, c, fold, &nfastack);
 				ncat = 1;
 				break;
 		}
 		cat = ncat;
 	}
-	while(LIST_Size(&tokenstack))
-		ConstructOperator(POLYTOKEN(LIST_TakeHead(&tokenstack)), unique, last, &nfastack);
-	NFA_Fragment *final = POLYFRAG(LIST_TakeHead(&nfastack));
+	while(DEQUE_Size(&tokenstack))
+		ConstructOperator(POLYTOKEN(DEQUE_TakeHead(&tokenstack)), unique, last, &nfastack);
+	NFA_Fragment *final = POLYFRAG(DEQUE_TakeHead(&nfastack));
+	DEQUE_Clear(&tokenstack);
+	DEQUE_Clear(&nfastack);
 	final->end->accepts = accepts;
 	NFA_Node *result = final->start;
 	free(final);
@@ -505,82 +1018,53 @@ int UnsignedLongComparator(POLY_Polymorphic key1, POLY_Polymorphic key2)
 	return 0;
 }
 
-// simplifies a DFA in place
-unsigned long SimplifyStates(DFA_Node *start)
+// helper function finds the state a state is merged into by simplification, the first state of its bin in the chain
+// takes a pointer to the state
+// returns a pointer to the state it is merged into, itself if it is kept
+DFA_Node *MergedState(DFA_Node *node)
 {
-	AVL_Tree bins;
-	AVL_Initialize(&bins, NULL, NULL, DFA_BinComparator);
-	DFA_Node *current = start;
-	while(current)
-	{
-		if(AVL_Contains(&bins, POLY_REF(current)))
-		{
-			DFA_Node *parent = POLYDFA(AVL_Get(&bins, POLY_REF(current)));
-			if(!parent->children) parent->children = AVL_Initialize(malloc(sizeof(AVL_Tree)), NULL, NULL, DFA_Comparator);
-			AVL_Insert(parent->children, POLY_REF(current));
-			current->parent = parent;
-		}
-		else
-		{
-			AVL_Set(&bins, POLY_REF(current), POLY_REF(current));
-			AVL_Initialize(current->children = malloc(sizeof(AVL_Tree)), NULL, NULL, DFA_Comparator);
-			current->parent = current;
-		}
-		current = current->next;
-	}
-	int rebinned = 1;
-	AVL_Iterator outer;
-	AVL_InitializeIterator(&bins, &outer);
-	while(rebinned)
+	return node->parent;
+}
+
+// simplifies a DFA in place, counting the rounds of refinement, the start states are replaced by those they are merged into
+// each round bins the states anew by the bins of the round before, so states are only merged if no string tells them apart
+// from any start, and start states of different contexts which are equivalent are merged as any other states are
+// the first start state stays the first state of the chain
+unsigned long SimplifyStates(DFA_Node **starts, unsigned long *rounds)
+{
+	DFA_Node *start = starts[0];
+	DFA_Node *current;
+	// every state begins in the bin of the start state, so the first round bins them by what they accept and transition on
+	for(current = start; current; current = current->next) current->surrogate = start;
+	unsigned long bins_count = 1;
+	while(1)
 	{
-		rebinned = 0;
-		AVL_Reset(&outer);
-		while(AVL_Next(&outer))
+		(*rounds)++;
+		AVL_Tree bins;
+		AVL_Initialize(&bins, NULL, NULL, DFA_BinComparator);
+		for(current = start; current; current = current->next)
 		{
-			DFA_Node *parent = POLYDFA(AVL_Key(&outer));
-			AVL_Tree *rebins = parent->children;
-			parent->children = AVL_Initialize(malloc(sizeof(AVL_Tree)), NULL, NULL, DFA_Comparator);
-			unsigned long osize = AVL_Size(rebins);
-			AVL_Iterator inner;
-			AVL_InitializeIterator(rebins, &inner);
-			while(AVL_Next(&inner))
-			{
-				DFA_Node *child = POLYDFA(AVL_Key(&inner));
-				if(AVL_Contains(&bins, POLY_REF(child)))
-				{
-					DFA_Node *surrogate = POLYDFA(AVL_Get(&bins, POLY_REF(child)));
-					AVL_Insert(surrogate->children, POLY_REF(child));
-					child->surrogate = surrogate;
-				}
-				else
-				{
-					AVL_Set(&bins, POLY_REF(child), POLY_REF(child));
-					AVL_Initialize(child->children = malloc(sizeof(AVL_Tree)), NULL, NULL, DFA_Comparator);
-					child->surrogate = child;
-				}
-			}
-			AVL_Reset(&inner);
-			while(AVL_Next(&inner))
+			if(AVL_Contains(&bins, POLY_REF(current))) current->parent = POLYDFA(AVL_Get(&bins, POLY_REF(current)));
+			else
 			{
-				DFA_Node *child = POLYDFA(AVL_Key(&inner));
-				child->parent = child->surrogate;
+				AVL_Set(&bins, POLY_REF(current), POLY_REF(current));
+				current->parent = current;
 			}
-			if(AVL_Size(parent->children) != osize) rebinned = 1;
-			AVL_Clear(rebins);
-			free(rebins);
-			if(rebinned) break;
 		}
+		unsigned long size = AVL_Size(&bins);
+		AVL_Clear(&bins);
+		// a round only ever splits bins, so one which makes no more bins than the last has made the same bins
+		if(size == bins_count) break;
+		bins_count = size;
+		for(current = start; current; current = current->next) current->surrogate = current->parent;
 	}
-	AVL_Insert(&bins, POLY_REF(start));
-	start->children = start->parent->children;
-	start->parent->parent = start;
-	start->parent->children = NULL;
-	start->parent = start;
 	current = start;
 	DFA_Node **fix = NULL;
+	DFA_Node *dropped = NULL;
 	unsigned long unique = 0;
 	while(current)
 	{
+		DFA_Node *next = current->next;
 		if(current->parent == current)
 		{
 			if(fix) *fix = current;
@@ -589,14 +1073,20 @@ unsigned long SimplifyStates(DFA_Node *start)
 			AVL_Iterator inner;
 			AVL_InitializeIterator(&current->transitions, &inner);
 			while(AVL_Next(&inner))
-				AVL_Set(&current->transitions, AVL_Key(&inner), POLY_REF(POLYDFA(AVL_Value(&inner))->parent));
-			if(current->children) AVL_Clear(current->children);
-			if(current->children) free(current->children);
+				AVL_Set(&current->transitions, AVL_Key(&inner), POLY_REF(MergedState(POLYDFA(AVL_Value(&inner)))));
 			unique++;
 		}
-		current = current->next;
+		else
+		{
+			// merged states are freed once no transition can still be redirected through them
+			current->next = dropped;
+			dropped = current;
+		}
+		current = next;
 	}
 	*fix = NULL;
+	for(int context = 0; context < REGEX_CONTEXTS; context++) starts[context] = MergedState(starts[context]);
+	DFA_DestroyChain(dropped);
 	return unique;
 }
 
@@ -604,25 +1094,304 @@ unsigned long SimplifyStates(DFA_Node *start)
 
 REGEX_Machine *REGEX_CreateMachine(REGEX_Expressions *expressions)
 {
+	return REGEX_CreateMachineWithOptions(expressions, NULL);
+}
+
+// comparator for tuples of DFA states of the same length, a missing state orders before any other
+int DFA_TupleComparator(POLY_Polymorphic key1, POLY_Polymorphic key2)
+{
+	DFA_Tuple *t1 = POLYTUPLE(key1);
+	DFA_Tuple *t2 = POLYTUPLE(key2);
+	for(unsigned long n = 0; n < t1->parts_count; n++)
+	{
+		DFA_Node *p1 = t1->parts[n];
+		DFA_Node *p2 = t2->parts[n];
+		if(p1 == p2) continue;
+		if(!p1) return -1;
+		if(!p2) return 1;
+		if(p1->identifier < p2->identifier) return -1;
+		if(p1->identifier > p2->identifier) return 1;
+	}
+	return 0;
+}
+
+// hasher for tuples of DFA states
+unsigned long long DFA_TupleHasher(POLY_Polymorphic key)
+{
+	unsigned long long hash = 0;
+	for(unsigned long n = 0; n < POLYTUPLE(key)->parts_count; n++)
+		hash = HASH_Mix(hash + (POLYTUPLE(key)->parts[n] ? POLYTUPLE(key)->parts[n]->identifier + 1 : 0));
+	return hash;
+}
+
+// equality test for tuples of DFA states
+int DFA_TupleEquality(POLY_Polymorphic key1, POLY_Polymorphic key2)
+{
+	return !DFA_TupleComparator(key1, key2);
+}
+
+// frees a tuple of DFA states
+void DFA_DestroyTuple(POLY_Polymorphic item)
+{
+	free(POLYTUPLE(item)->parts);
+	free(POLYTUPLE(item));
+}
+
+// creates a tuple of DFA states with every state missing
+DFA_Tuple *DFA_CreateTuple(unsigned long parts_count)
+{
+	DFA_Tuple *tuple = malloc(sizeof(DFA_Tuple));
+	tuple->parts_count = parts_count;
+	tuple->parts = calloc(parts_count, sizeof(DFA_Node*));
+	return tuple;
+}
+
+// finds the mapping from a tuple of DFA states to a DFA state, or creates the mapping if it doesn't exist and queues unexplored tuples
+// the accepts values of a tuple are the largest of its states, as GetAccepts does for sets of NFA states
+DFA_Node *MapTuple(HASH_Table *map, DFA_Tuple *tuple, unsigned long *unique, DFA_Node **last, DEQUE_Deque *unexplored)
+{
+	DFA_Node *node = POLYDFA(HASH_Get(map, POLY_REF(tuple)));
+	if(node)
+	{
+		DFA_DestroyTuple(POLY_REF(tuple));
+		return node;
+	}
+	node = DFA_CreateState(unique, last);
+	HASH_Set(map, POLY_REF(tuple), POLY_REF(node));
+	DEQUE_InsertHead(unexplored, POLY_REF(tuple));
+	node->accepts = 0;
+	for(unsigned long n = 0; n < tuple->parts_count; n++)
+		if(tuple->parts[n] && tuple->parts[n]->accepts > node->accepts) node->accepts = tuple->parts[n]->accepts;
+	for(unsigned long n = 0; n < tuple->parts_count; n++)
+	{
+		if(!tuple->parts[n] || !tuple->parts[n]->conditional) continue;
+		if(!node->conditional)
+		{
+			node->conditional = MEM_ALLOCATE(MEM_DFA, sizeof(unsigned long)*REGEX_CONTEXTS);
+			for(int context = 0; context < REGEX_CONTEXTS; context++) node->conditional[context] = node->accepts;
+		}
+		for(int context = 0; context < REGEX_CONTEXTS; context++)
+			if(tuple->parts[n]->conditional[context] > node->conditional[context]) node->conditional[context] = tuple->parts[n]->conditional[context];
+	}
+	// as SetAccepts does, a state accepting the same whatever follows has no conditional values, so simplification merges it
+	// with states of other tuples that accept the same
+	int differs = 0;
+	for(int context = 0; node->conditional && context < REGEX_CONTEXTS; context++)
+		if(node->conditional[context] != node->accepts) differs = 1;
+	if(node->conditional && !differs)
+	{
+		MEM_RELEASE(MEM_DFA, node->conditional, sizeof(unsigned long)*REGEX_CONTEXTS);
+		node->conditional = NULL;
+	}
+	return node;
+}
+
+// combines several DFAs into one accepting the union of their languages by the product construction
+// the union starts in each context in the tuple of the states the DFAs start in for that context
+// takes the start states of each DFA, the number of DFAs, the numbering and chain of the union and its start states to fill in
+// returns the first state of the chain, the start for REGEX_TEXT
+DFA_Node *Union(DFA_Node *(*dfas)[REGEX_CONTEXTS], unsigned long dfas_count, unsigned long *unique, DFA_Node **last, DFA_Node **starts)
+{
+	HASH_Table map;
+	HASH_Initialize(&map, DFA_DestroyTuple, NULL, DFA_TupleHasher, DFA_TupleEquality);
+	DEQUE_Deque unexplored;
+	DEQUE_Initialize(&unexplored);
+	for(int context = 0; context < REGEX_CONTEXTS; context++)
+	{
+		DFA_Tuple *initial = DFA_CreateTuple(dfas_count);
+		for(unsigned long n = 0; n < dfas_count; n++) initial->parts[n] = dfas[n][context];
+		starts[context] = MapTuple(&map, initial, unique, last, &unexplored);
+	}
+	while(DEQUE_Size(&unexplored))
+	{
+		DFA_Tuple *tuple = POLYTUPLE(DEQUE_TakeTail(&unexplored));
+		DFA_Node *node = POLYDFA(HASH_Get(&map, POLY_REF(tuple)));
+		AVL_Tree symbols;
+		AVL_Initialize(&symbols, NULL, NULL, UNICODE_CharComparator);
+		for(unsigned long n = 0; n < tuple->parts_count; n++)
+		{
+			if(!tuple->parts[n]) continue;
+			AVL_Iterator iter;
+			AVL_InitializeIterator(&tuple->parts[n]->transitions, &iter);
+			while(AVL_Next(&iter)) SymbolMapInsert(&symbols, AVL_Key(&iter));
+		}
+		AVL_Iterator iter;
+		AVL_InitializeIterator(&symbols, &iter);
+		while(AVL_Next(&iter))
+		{
+			DFA_Tuple *target = DFA_CreateTuple(tuple->parts_count);
+			for(unsigned long n = 0; n < tuple->parts_count; n++)
+				if(tuple->parts[n]) target->parts[n] = POLYDFA(SymbolMapGet(&tuple->parts[n]->transitions, AVL_Key(&iter)));
+			SymbolMapSet(&node->transitions, AVL_Key(&iter), POLY_REF(MapTuple(&map, target, unique, last, &unexplored)));
+		}
+		AVL_Clear(&symbols);
+	}
+	DEQUE_Clear(&unexplored);
+	HASH_Clear(&map);
+	return starts[0];
+}
+
+// reads a monotonic clock
+// returns the time in seconds
+double Clock()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec*1e-9;
+}
+
+// adds the measurements of part of a compilation to the measurements of the whole
+void AddStats(REGEX_Stats *total, REGEX_Stats *part)
+{
+	total->nfa_states += part->nfa_states;
+	total->nfa_transitions += part->nfa_transitions;
+	total->nfa_epsilons += part->nfa_epsilons;
+	total->dfa_states += part->dfa_states;
+	total->union_states += part->union_states;
+	total->machine_states += part->machine_states;
+	total->refinement_rounds += part->refinement_rounds;
+	total->subset_states += part->subset_states;
+	if(part->subset_largest > total->subset_largest) total->subset_largest = part->subset_largest;
+	total->avl_allocations += part->avl_allocations;
+	total->construct_seconds += part->construct_seconds;
+	total->convert_seconds += part->convert_seconds;
+	total->simplify_seconds += part->simplify_seconds;
+	total->union_seconds += part->union_seconds;
+	total->export_seconds += part->export_seconds;
+}
+
+// counts the states and edges of an NFA
+void MeasureNFA(NFA_Node *start, REGEX_Stats *stats)
+{
+	for(NFA_Node *current = start; current; current = current->next)
+	{
+		stats->nfa_states++;
+		stats->nfa_epsilons += AVL_Size(&current->epsilons);
+		AVL_Iterator iter;
+		AVL_InitializeIterator(&current->transitions, &iter);
+		while(AVL_Next(&iter)) stats->nfa_transitions += AVL_Size(AVL_POLYTREE(AVL_Value(&iter)));
+	}
+}
+
+// constructs the NFA for a range of expressions and converts it to a simplified DFA, filling in its start states
+// returns the first state of the chain, the start for REGEX_TEXT
+DFA_Node *CompileExpressions(REGEX_Expression *expressions, unsigned long expressions_count, unsigned int threads, unsigned long *states_count, DFA_Node **starts, REGEX_Stats *stats)
+{
+	double began = Clock();
+	unsigned long allocations = AVL_Allocations();
 	unsigned long uniquenfa = 0;
 	NFA_Node *lastnfa = NULL;
 	NFA_Node *start = NFA_CreateState(&uniquenfa, &lastnfa);
-	for(unsigned long n = 0; n < expressions->expressions_count; n++)
+	for(unsigned long n = 0; n < expressions_count; n++)
 	{
-		NFA_Node *nfa = ConstructNFA(&uniquenfa, &lastnfa, expressions->expressions[n].accepts, expressions->expressions[n].expression);
+		NFA_Node *nfa = ConstructNFA(&uniquenfa, &lastnfa, expressions[n].accepts, expressions[n].flags, expressions[n].expression);
 		AVL_Insert(&start->epsilons, POLY_REF(nfa));
 	}
+	// markers are only made for NFAs with assertions, so other NFAs convert as they always have
+	NFA_Node *markers[REGEX_CONTEXTS];
+	int asserts = 0;
+	for(NFA_Node *current = start; current; current = current->next) if(current->condition) asserts = 1;
+	for(int context = 0; asserts && context < REGEX_CONTEXTS; context++)
+	{
+		markers[context] = NFA_CreateState(&uniquenfa, &lastnfa);
+		markers[context]->context = context;
+	}
+	stats->construct_seconds += Clock() - began;
+	MeasureNFA(start, stats);
+	began = Clock();
 	unsigned long uniquedfa = 0;
 	DFA_Node *lastdfa = NULL;
-	DFA_Node *dfa = Convert(start, &uniquedfa, &lastdfa);
-	REGEX_Machine *result = malloc(sizeof(REGEX_Machine));
-	result->states = malloc(sizeof(REGEX_State)*(result->states_count = SimplifyStates(dfa)));
+	DFA_Node *dfa;
+	if(threads > 1) dfa = ConvertParallel(start, asserts ? markers : NULL, &uniquedfa, &lastdfa, threads, stats, starts);
+	else dfa = Convert(start, asserts ? markers : NULL, &uniquedfa, &lastdfa, stats, starts);
+	NFA_DestroyChain(start);
+	stats->dfa_states += uniquedfa;
+	stats->convert_seconds += Clock() - began;
+	began = Clock();
+	*states_count = SimplifyStates(starts, &stats->refinement_rounds);
+	stats->machine_states += *states_count;
+	stats->simplify_seconds += Clock() - began;
+	stats->avl_allocations += AVL_Allocations() - allocations;
+	return dfa;
+}
+
+// compiles a group as a task
+void CompileGroup(POLY_Polymorphic argument)
+{
+	Group *group = argument.ref;
+	unsigned long states_count;
+	CompileExpressions(group->expressions, group->expressions_count, 0, &states_count, group->starts, &group->stats);
+}
+
+// splits the expressions into groups, compiles the groups in parallel and combines them into a simplified DFA, filling in its start states
+// returns the first state of the chain, the start for REGEX_TEXT
+DFA_Node *CompileGrouped(REGEX_Expressions *expressions, unsigned int groups_count, unsigned int threads, unsigned long *states_count, DFA_Node **starts, REGEX_Stats *stats)
+{
+	Group *groups = malloc(sizeof(Group)*groups_count);
+	unsigned long offset = 0;
+	for(unsigned int n = 0; n < groups_count; n++)
+	{
+		unsigned long count = (expressions->expressions_count - offset)/(groups_count - n);
+		groups[n].expressions = expressions->expressions + offset;
+		groups[n].expressions_count = count;
+		memset(&groups[n].stats, 0, sizeof(REGEX_Stats));
+		offset += count;
+	}
+	if(threads > groups_count) threads = groups_count;
+	if(threads < 1) threads = 1;
+	// the calling thread runs groups while it waits, so the pool needs one thread fewer
+	TASK_Pool pool;
+	TASK_Initialize(&pool, threads - 1);
+	TASK_Group compiling;
+	TASK_InitializeGroup(&pool, &compiling);
+	for(unsigned int n = 0; n < groups_count; n++) TASK_Spawn(&compiling, CompileGroup, POLY_REF(&groups[n]));
+	TASK_Wait(&compiling);
+	TASK_Clear(&pool);
+	DFA_Node *(*dfas)[REGEX_CONTEXTS] = malloc(sizeof(*dfas)*groups_count);
+	for(unsigned int n = 0; n < groups_count; n++)
+	{
+		memcpy(dfas[n], groups[n].starts, sizeof(*dfas));
+		AddStats(stats, &groups[n].stats);
+	}
+	free(groups);
+	double began = Clock();
+	unsigned long allocations = AVL_Allocations();
+	unsigned long unique = 0;
+	DFA_Node *last = NULL;
+	DFA_Node *dfa = Union(dfas, groups_count, &unique, &last, starts);
+	for(unsigned int n = 0; n < groups_count; n++) DFA_DestroyChain(dfas[n][REGEX_TEXT]);
+	free(dfas);
+	stats->union_states += unique;
+	stats->union_seconds += Clock() - began;
+	began = Clock();
+	*states_count = SimplifyStates(starts, &stats->refinement_rounds);
+	stats->machine_states = *states_count;
+	stats->simplify_seconds += Clock() - began;
+	stats->avl_allocations += AVL_Allocations() - allocations;
+	return dfa;
+}
+
+REGEX_Machine *REGEX_CreateMachineWithOptions(REGEX_Expressions *expressions, REGEX_Options *options)
+{
+	unsigned int threads = options ? options->threads : 0;
+	unsigned int groups = options ? options->groups : 0;
+	if(groups > expressions->expressions_count) groups = expressions->expressions_count;
+	REGEX_Stats stats;
+	memset(&stats, 0, sizeof(REGEX_Stats));
+	REGEX_Machine *result = MEM_ALLOCATE(MEM_MACHINE, sizeof(REGEX_Machine));
+	DFA_Node *dfa;
+	DFA_Node *starts[REGEX_CONTEXTS];
+	if(groups > 1) dfa = CompileGrouped(expressions, groups, threads, &result->states_count, starts, &stats);
+	else dfa = CompileExpressions(expressions->expressions, expressions->expressions_count, threads, &result->states_count, starts, &stats);
+	for(int context = 0; context < REGEX_CONTEXTS; context++) result->starts[context] = starts[context]->identifier;
+	double began = Clock();
+	result->states = MEM_ALLOCATE(MEM_MACHINE, sizeof(REGEX_State)*result->states_count);
 	DFA_Node *current = dfa;
 	for(unsigned long n = 0; n < result->states_count; n++)
 	{
 		REGEX_State *state = &result->states[n];
 		state->transitions_count = AVL_Size(&current->transitions);
-		REGEX_Transition *transitions = state->transitions = malloc(sizeof(REGEX_Transition)*state->transitions_count);
+		REGEX_Transition *transitions = state->transitions = MEM_ALLOCATE(MEM_MACHINE, sizeof(REGEX_Transition)*state->transitions_count);
 		AVL_Iterator iter;
 		AVL_InitializeIterator(&current->transitions, &iter);
 		for(unsigned short i = 0; i < state->transitions_count; i++)
@@ -632,8 +1401,19 @@ REGEX_Machine *REGEX_CreateMachine(REGEX_Expressions *expressions)
 			transitions[i].to = POLYDFA(AVL_Value(&iter))->identifier;
 		}
 		state->accepts = current->accepts;
+		state->conditional = NULL;
+		if(current->conditional)
+		{
+			state->conditional = MEM_ALLOCATE(MEM_MACHINE, sizeof(unsigned long)*REGEX_CONTEXTS);
+			memcpy(state->conditional, current->conditional, sizeof(unsigned long)*REGEX_CONTEXTS);
+		}
 		current = current->next;
 	}
+	stats.export_seconds += Clock() - began;
+	DFA_DestroyChain(dfa);
+	// nodes pooled by this thread are not needed between compilations
+	AVL_ReleasePool();
+	if(options && options->stats) *options->stats = stats;
 	return result;
 }
 
@@ -642,8 +1422,21 @@ void REGEX_DestroyMachine(REGEX_Machine *machine)
 	for(unsigned long n = 0; n < machine->states_count; n++)
 	{
 		REGEX_State *state = &machine->states[n];
-		free(state->transitions);
+		MEM_RELEASE(MEM_MACHINE, state->transitions, sizeof(REGEX_Transition)*state->transitions_count);
+		if(state->conditional) MEM_RELEASE(MEM_MACHINE, state->conditional, sizeof(unsigned long)*REGEX_CONTEXTS);
 	}
-	free(machine->states);
-	free(machine);
+	MEM_RELEASE(MEM_MACHINE, machine->states, sizeof(REGEX_State)*machine->states_count);
+	MEM_RELEASE(MEM_MACHINE, machine, sizeof(REGEX_Machine));
+}
+
+int REGEX_Context(UNICODE_Char c)
+{
+	if(c == '\n') return REGEX_LINE;
+	if((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_') return REGEX_WORD;
+	return REGEX_OTHER;
+}
+
+unsigned long REGEX_Accepts(REGEX_State *state, int next)
+{
+	return state->conditional ? state->conditional[next] : state->accepts;
 }
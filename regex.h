@@ -10,10 +10,28 @@ All Rights Reserved
 #ifndef REGEX_H
 #define REGEX_H
 
+// contexts a position in text is seen in by an assertion, the class of the character on one side of the position
+// REGEX_TEXT is the start or end of the text, REGEX_LINE a newline, REGEX_WORD an ASCII letter, digit or underscore
+// and REGEX_OTHER any other character
+#define REGEX_TEXT     0
+#define REGEX_LINE     1
+#define REGEX_WORD     2
+#define REGEX_OTHER    3
+#define REGEX_CONTEXTS 4
+
+// flags of an expression
+// REGEX_CASE_INSENSITIVE matches each character of the expression as any character equal to it by simple case folding
+#define REGEX_CASE_INSENSITIVE 1
+
+// an expression, the value its matches accept with and its flags
+// besides characters and the operators ( ) . | * ? + an expression may hold the assertions ^ and $, which hold at the
+// start and end of a line, \A and \z, which hold at the start and end of the text, and \b and \B, which hold at a word
+// boundary and anywhere else, a backslash before any other character matches that character
 typedef struct
 {
 	UNICODE_Char *expression;
 	unsigned long accepts;
+	unsigned int flags;
 } REGEX_Expression;
 
 typedef struct
@@ -28,21 +46,81 @@ typedef struct
 	unsigned long to;
 } REGEX_Transition;
 
+// a state of a machine, accepts is the value the state accepts with whatever follows
+// conditional is NULL unless what the state accepts depends on assertions about what follows, in which case
+// conditional[context] is the value it accepts with before a character of that context, or REGEX_TEXT at the end of the text
 typedef struct
 {
 	REGEX_Transition *transitions;
 	unsigned short transitions_count;
 	unsigned long accepts;
+	unsigned long *conditional;
 } REGEX_State;
 
+// a machine is run from starts[context], the context being that of the character before the position matching starts at,
+// or REGEX_TEXT at the start of the text, so assertions are checked in the same scan which follows the transitions
+// the starts are all state 0 unless an expression holds assertions
 typedef struct
 {
 	REGEX_State *states;
 	unsigned long states_count;
+	unsigned long starts[REGEX_CONTEXTS];
 } REGEX_Machine;
 
+// measurements of a compilation, times are wall clock seconds spent in each phase
+// nfa_states, nfa_transitions and nfa_epsilons count the NFA states, edges on characters and epsilon edges constructed
+// dfa_states counts the states made by subset construction and union_states those made by the union of groups
+// machine_states counts the states of the resulting machine, simplification took refinement_rounds rounds of refinement
+// subset_states sums the number of NFA states over every set of NFA states subset construction mapped to a DFA state,
+// and subset_largest is the size of the largest such set
+// avl_allocations counts the AVL tree nodes allocated by the compilation on every thread it used
+// when expressions are grouped, counts other than machine_states and times are summed over all groups
+typedef struct
+{
+	unsigned long nfa_states;
+	unsigned long nfa_transitions;
+	unsigned long nfa_epsilons;
+	unsigned long dfa_states;
+	unsigned long union_states;
+	unsigned long machine_states;
+	unsigned long refinement_rounds;
+	unsigned long subset_states;
+	unsigned long subset_largest;
+	unsigned long avl_allocations;
+	double construct_seconds;
+	double convert_seconds;
+	double simplify_seconds;
+	double union_seconds;
+	double export_seconds;
+} REGEX_Stats;
+
+// options controlling how a machine is compiled
+// threads is the number of worker threads used for subset construction, 0 or 1 compiles serially
+// groups is the number of groups the expressions are split into, each group is compiled to its own
+// minimal DFA on its own thread and the results are combined by a union construction, 0 or 1 disables grouping
+// stats, if not NULL, is filled in with measurements of the compilation
+typedef struct
+{
+	unsigned int threads;
+	unsigned int groups;
+	REGEX_Stats *stats;
+} REGEX_Options;
+
 REGEX_Machine *REGEX_CreateMachine(REGEX_Expressions *expressions);
 
+// compiles a machine as REGEX_CreateMachine does, options may be NULL to use the defaults
+REGEX_Machine *REGEX_CreateMachineWithOptions(REGEX_Expressions *expressions, REGEX_Options *options);
+
 void REGEX_DestroyMachine(REGEX_Machine *machine);
 
+// finds the context of a character as seen by assertions
+// takes the character
+// returns REGEX_LINE, REGEX_WORD or REGEX_OTHER
+int REGEX_Context(UNICODE_Char c);
+
+// finds the value a state accepts with before a character of a given context
+// takes a pointer to the state and the context of the next character, REGEX_TEXT at the end of the text
+// returns the accepts value, 0 if the state does not accept there
+unsigned long REGEX_Accepts(REGEX_State *state, int next);
+
 #endif
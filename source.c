@@ -14,6 +14,7 @@ int main(int argc, char **argv)
 	{
 		fscanf(fp, "%s\n", buf);
 		expr.expressions[n].accepts = n+1;
+		expr.expressions[n].flags = 0;
 		expr.expressions[n].expression = malloc(sizeof(UNICODE_Char)*(strlen(buf)+1));
 		expr.expressions[n].expression[strlen(buf)] = 0;
 		for(int i = 0; buf[i]; i++)
@@ -32,4 +33,9 @@ int main(int argc, char **argv)
 		}
 		printf("\n");
 	}
+	REGEX_DestroyMachine(machine);
+	for(unsigned long n = 0; n < expr.expressions_count; n++) free(expr.expressions[n].expression);
+	free(expr.expressions);
+	fclose(fp);
+	return 0;
 }
@@ -0,0 +1,312 @@
+/*
+Source file for work-stealing task runtime
+
+Copyright (C) 2016 Kyle Gagner
+All Rights Reserved
+*/
+
+#include <stdlib.h>
+#include <sched.h>
+#include "task.h"
+
+// capacity of the first buffer of a deque
+#define MINIMUM 64
+
+// number of times an idle worker looks for a task before sleeping
+#define SPINS 64
+
+// represents a spawned task
+typedef struct TASK_Task
+{
+	TASK_Function function;
+	POLY_Polymorphic argument;
+	TASK_Group *group;
+} TASK_Task;
+
+// represents a part of the range of a parallel for not yet split or run
+typedef struct TASK_Range
+{
+	TASK_Group *group;
+	TASK_RangeFunction function;
+	POLY_Polymorphic argument;
+	unsigned long begin;
+	unsigned long end;
+	unsigned long grain;
+} TASK_Range;
+
+// the worker run by the current thread, NULL for threads outside any pool
+_Thread_local TASK_Worker *TASK_current = NULL;
+
+// helper function allocates the buffer of a deque
+// takes the capacity, a power of two, and the buffer it replaces or NULL
+// returns a pointer to the buffer
+TASK_Buffer *TASK_CreateBuffer(long capacity, TASK_Buffer *retired)
+{
+	TASK_Buffer *buffer = malloc(sizeof(TASK_Buffer) + sizeof(unsigned long long)*capacity);
+	buffer->retired = retired;
+	buffer->capacity = capacity;
+	return buffer;
+}
+
+TASK_Deque *TASK_InitializeDeque(TASK_Deque *deque)
+{
+	atomic_init(&deque->top, 0);
+	atomic_init(&deque->bottom, 0);
+	atomic_init(&deque->buffer, TASK_CreateBuffer(MINIMUM, NULL));
+	return deque;
+}
+
+void TASK_ClearDeque(TASK_Deque *deque)
+{
+	TASK_Buffer *buffer = atomic_load(&deque->buffer);
+	while(buffer)
+	{
+		TASK_Buffer *retired = buffer->retired;
+		free(buffer);
+		buffer = retired;
+	}
+	atomic_store(&deque->buffer, NULL);
+}
+
+void TASK_Push(TASK_Deque *deque, POLY_Polymorphic value)
+{
+	long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+	long top = atomic_load(&deque->top);
+	TASK_Buffer *buffer = atomic_load_explicit(&deque->buffer, memory_order_relaxed);
+	if(bottom - top >= buffer->capacity)
+	{
+		// the values are copied to the same positions of a buffer twice as large, so thieves holding either buffer agree
+		TASK_Buffer *grown = TASK_CreateBuffer(buffer->capacity*2, buffer);
+		for(long n = top; n < bottom; n++)
+			atomic_store_explicit(&grown->values[n & (grown->capacity - 1)], atomic_load_explicit(&buffer->values[n & (buffer->capacity - 1)], memory_order_relaxed), memory_order_relaxed);
+		atomic_store(&deque->buffer, grown);
+		buffer = grown;
+	}
+	atomic_store_explicit(&buffer->values[bottom & (buffer->capacity - 1)], value.uint64, memory_order_relaxed);
+	atomic_store(&deque->bottom, bottom + 1);
+}
+
+int TASK_Pop(TASK_Deque *deque, POLY_Polymorphic *value)
+{
+	long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+	TASK_Buffer *buffer = atomic_load_explicit(&deque->buffer, memory_order_relaxed);
+	// the bottom is claimed before the top is read, so a thief reading the bottom after this cannot take the same value
+	atomic_store(&deque->bottom, bottom);
+	long top = atomic_load(&deque->top);
+	if(top > bottom)
+	{
+		atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+		return 0;
+	}
+	value->uint64 = atomic_load_explicit(&buffer->values[bottom & (buffer->capacity - 1)], memory_order_relaxed);
+	if(top < bottom) return 1;
+	// the last value may be contended by a thief, whoever advances the top first has it
+	int won = atomic_compare_exchange_strong(&deque->top, &top, top + 1);
+	atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+	return won;
+}
+
+int TASK_Steal(TASK_Deque *deque, POLY_Polymorphic *value)
+{
+	long top = atomic_load(&deque->top);
+	long bottom = atomic_load(&deque->bottom);
+	if(top >= bottom) return 0;
+	TASK_Buffer *buffer = atomic_load(&deque->buffer);
+	unsigned long long bits = atomic_load_explicit(&buffer->values[top & (buffer->capacity - 1)], memory_order_relaxed);
+	if(!atomic_compare_exchange_strong(&deque->top, &top, top + 1)) return 0;
+	value->uint64 = bits;
+	return 1;
+}
+
+// helper function finds a task for a thread to run
+// a worker looks on its own deque first, then every thread looks at tasks spawned from outside and at the other deques
+// takes a pointer to the pool and the worker of the calling thread, or NULL if the thread is not one of the pool
+// returns a pointer to the task or NULL if none was found
+TASK_Task *TASK_Find(TASK_Pool *pool, TASK_Worker *worker)
+{
+	POLY_Polymorphic value;
+	if(worker && TASK_Pop(&worker->deque, &value)) return value.ref;
+	if(QUEUE_TryTakeHead(&pool->injected, &value)) return value.ref;
+	if(!pool->workers_count) return NULL;
+	// victims are visited from a random start so thieves spread over the deques
+	unsigned int start = 0;
+	if(worker)
+	{
+		worker->seed ^= worker->seed << 13;
+		worker->seed ^= worker->seed >> 7;
+		worker->seed ^= worker->seed << 17;
+		start = worker->seed % pool->workers_count;
+	}
+	for(unsigned int n = 0; n < pool->workers_count; n++)
+	{
+		TASK_Worker *victim = &pool->workers[(start + n) % pool->workers_count];
+		if(victim != worker && TASK_Steal(&victim->deque, &value)) return value.ref;
+	}
+	return NULL;
+}
+
+// helper function runs a task and frees it
+// takes a pointer to the task
+void TASK_Run(TASK_Task *task)
+{
+	TASK_Group *group = task->group;
+	task->function(task->argument);
+	free(task);
+	atomic_fetch_sub(&group->pending, 1);
+}
+
+// helper function wakes a sleeping worker after a task is spawned
+// the check of sleepers is ordered after the task is published, and a sleeper is counted before it looks for tasks,
+// so either the sleeper finds the task or it is counted here, and it cannot miss the wakeup since it holds the lock until it sleeps
+// takes a pointer to the pool
+void TASK_Wake(TASK_Pool *pool)
+{
+	if(!atomic_load(&pool->sleepers)) return;
+	pthread_mutex_lock(&pool->lock);
+	pthread_cond_signal(&pool->wake);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+// helper function runs tasks on a thread of a pool until the pool is stopped
+// takes a pointer to the worker
+// returns NULL
+void *TASK_Work(void *argument)
+{
+	TASK_Worker *worker = argument;
+	TASK_Pool *pool = worker->pool;
+	TASK_current = worker;
+	while(1)
+	{
+		TASK_Task *task = NULL;
+		for(int n = 0; n < SPINS && !task; n++)
+		{
+			task = TASK_Find(pool, worker);
+			if(!task) sched_yield();
+		}
+		if(!task)
+		{
+			pthread_mutex_lock(&pool->lock);
+			atomic_fetch_add(&pool->sleepers, 1);
+			while(!(task = TASK_Find(pool, worker)) && !atomic_load(&pool->stopping))
+				pthread_cond_wait(&pool->wake, &pool->lock);
+			atomic_fetch_sub(&pool->sleepers, 1);
+			pthread_mutex_unlock(&pool->lock);
+			if(!task) break;
+		}
+		TASK_Run(task);
+	}
+	TASK_current = NULL;
+	return NULL;
+}
+
+TASK_Pool *TASK_Initialize(TASK_Pool *pool, unsigned int threads)
+{
+	pool->workers_count = threads;
+	pool->workers = threads ? malloc(sizeof(TASK_Worker)*threads) : NULL;
+	QUEUE_Initialize(&pool->injected, TASK_INJECTED);
+	atomic_init(&pool->sleepers, 0);
+	atomic_init(&pool->stopping, 0);
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->wake, NULL);
+	for(unsigned int n = 0; n < threads; n++)
+	{
+		TASK_InitializeDeque(&pool->workers[n].deque);
+		pool->workers[n].pool = pool;
+		pool->workers[n].index = n;
+		pool->workers[n].seed = 2*n + 1;
+	}
+	// every worker is initialized before any thread starts, since each may steal from all the others
+	for(unsigned int n = 0; n < threads; n++)
+		pthread_create(&pool->workers[n].thread, NULL, TASK_Work, &pool->workers[n]);
+	return pool;
+}
+
+void TASK_Clear(TASK_Pool *pool)
+{
+	pthread_mutex_lock(&pool->lock);
+	atomic_store(&pool->stopping, 1);
+	pthread_cond_broadcast(&pool->wake);
+	pthread_mutex_unlock(&pool->lock);
+	for(unsigned int n = 0; n < pool->workers_count; n++)
+	{
+		pthread_join(pool->workers[n].thread, NULL);
+		TASK_ClearDeque(&pool->workers[n].deque);
+	}
+	free(pool->workers);
+	pool->workers = NULL;
+	pool->workers_count = 0;
+	QUEUE_Clear(&pool->injected);
+	pthread_mutex_destroy(&pool->lock);
+	pthread_cond_destroy(&pool->wake);
+}
+
+TASK_Group *TASK_InitializeGroup(TASK_Pool *pool, TASK_Group *group)
+{
+	group->pool = pool;
+	atomic_init(&group->pending, 0);
+	return group;
+}
+
+void TASK_Spawn(TASK_Group *group, TASK_Function function, POLY_Polymorphic argument)
+{
+	TASK_Pool *pool = group->pool;
+	TASK_Task *task = malloc(sizeof(TASK_Task));
+	task->function = function;
+	task->argument = argument;
+	task->group = group;
+	atomic_fetch_add(&group->pending, 1);
+	if(TASK_current && TASK_current->pool == pool) TASK_Push(&TASK_current->deque, POLY_REF(task));
+	// a thread outside the pool runs the task itself when the shared queue is full
+	else if(!QUEUE_InsertTail(&pool->injected, POLY_REF(task)))
+	{
+		TASK_Run(task);
+		return;
+	}
+	TASK_Wake(pool);
+}
+
+void TASK_Wait(TASK_Group *group)
+{
+	TASK_Pool *pool = group->pool;
+	TASK_Worker *worker = TASK_current && TASK_current->pool == pool ? TASK_current : NULL;
+	while(atomic_load(&group->pending))
+	{
+		// the waiting thread helps rather than blocking, so nested waits cannot starve the pool of threads
+		TASK_Task *task = TASK_Find(pool, worker);
+		if(task) TASK_Run(task);
+		else sched_yield();
+	}
+}
+
+// helper function runs a parallel for over part of its range, spawning the upper half while the part is larger than the grain
+// takes a pointer to the part
+void TASK_RunRange(POLY_Polymorphic argument)
+{
+	TASK_Range *range = argument.ref;
+	while(range->end - range->begin > range->grain)
+	{
+		TASK_Range *upper = malloc(sizeof(TASK_Range));
+		*upper = *range;
+		upper->begin = range->begin + (range->end - range->begin)/2;
+		range->end = upper->begin;
+		TASK_Spawn(range->group, TASK_RunRange, POLY_REF(upper));
+	}
+	range->function(range->argument, range->begin, range->end);
+	free(range);
+}
+
+void TASK_ParallelFor(TASK_Pool *pool, unsigned long begin, unsigned long end, unsigned long grain, TASK_RangeFunction function, POLY_Polymorphic argument)
+{
+	if(begin >= end) return;
+	TASK_Group group;
+	TASK_InitializeGroup(pool, &group);
+	TASK_Range *range = malloc(sizeof(TASK_Range));
+	range->group = &group;
+	range->function = function;
+	range->argument = argument;
+	range->begin = begin;
+	range->end = end;
+	range->grain = grain ? grain : 1;
+	TASK_RunRange(POLY_REF(range));
+	TASK_Wait(&group);
+}
@@ -0,0 +1,140 @@
+/*
+Header file for work-stealing task runtime
+
+Copyright (C) 2016 Kyle Gagner
+All Rights Reserved
+*/
+
+// for threads
+#include <pthread.h>
+// for atomics
+#include <stdatomic.h>
+// for polymorphism
+#include "poly.h"
+// for tasks submitted from outside a pool
+#include "queue.h"
+
+// include guard
+#ifndef TASK_H
+#define TASK_H
+
+// a definition for NULL may be needed
+#ifndef NULL
+#define NULL ((void*)0)
+#endif
+
+// alignment of the ends of a deque and of workers, the size of a cache line, so threads do not share lines needlessly
+#define TASK_ALIGNMENT 64
+
+// capacity of the queue of tasks submitted from threads outside a pool, more are run by the submitting thread
+#define TASK_INJECTED 1024
+
+// a function run as a task
+// takes the argument given when the task was spawned
+typedef void (*TASK_Function)(POLY_Polymorphic argument);
+
+// a function run over part of a range by a parallel for
+// takes the argument given to the parallel for and the start and end of the part, the end being exclusive
+typedef void (*TASK_RangeFunction)(POLY_Polymorphic argument, unsigned long begin, unsigned long end);
+
+// represents the buffer of a work-stealing deque, buffers replaced by growth are kept until the deque is cleared
+// since a thief may still be reading from them
+typedef struct TASK_Buffer
+{
+	struct TASK_Buffer *retired;
+	long capacity;
+	_Atomic unsigned long long values[];
+} TASK_Buffer;
+
+// represents a Chase-Lev work-stealing deque
+// its owner pushes and pops at the bottom without locks, any other thread may steal from the top
+typedef struct TASK_Deque
+{
+	_Alignas(TASK_ALIGNMENT) _Atomic long top;
+	_Alignas(TASK_ALIGNMENT) _Atomic long bottom;
+	_Atomic(TASK_Buffer*) buffer;
+} TASK_Deque;
+
+// represents a thread of a pool
+typedef struct TASK_Worker
+{
+	_Alignas(TASK_ALIGNMENT) TASK_Deque deque;
+	struct TASK_Pool *pool;
+	unsigned int index;
+	unsigned long seed;
+	pthread_t thread;
+} TASK_Worker;
+
+// represents a fixed pool of threads running tasks
+// tasks spawned by a worker go on its own deque, idle workers steal from the others, and tasks spawned from
+// outside the pool go on a shared queue, workers with nothing to do sleep until a task is spawned
+typedef struct TASK_Pool
+{
+	TASK_Worker *workers;
+	unsigned int workers_count;
+	QUEUE_Queue injected;
+	_Atomic unsigned long sleepers;
+	_Atomic int stopping;
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+} TASK_Pool;
+
+// represents a set of tasks which may be waited on together
+typedef struct TASK_Group
+{
+	TASK_Pool *pool;
+	_Atomic unsigned long pending;
+} TASK_Group;
+
+// initialize a work-stealing deque
+// takes a pointer to the deque to initialize
+// returns a pointer to the deque
+TASK_Deque *TASK_InitializeDeque(TASK_Deque *deque);
+
+// remove all items from a work-stealing deque and free memory, no other thread may be using the deque
+// takes a pointer to the deque
+void TASK_ClearDeque(TASK_Deque *deque);
+
+// push a value on the bottom of a work-stealing deque, only the owner of the deque may push
+// takes a pointer to the deque and the value
+void TASK_Push(TASK_Deque *deque, POLY_Polymorphic value);
+
+// pop a value from the bottom of a work-stealing deque, only the owner of the deque may pop
+// takes a pointer to the deque and where to put the value
+// returns 1 if a value was popped, 0 if the deque is empty
+int TASK_Pop(TASK_Deque *deque, POLY_Polymorphic *value);
+
+// steal a value from the top of a work-stealing deque, any thread may steal
+// takes a pointer to the deque and where to put the value
+// returns 1 if a value was stolen, 0 if the deque is empty or the value was taken by another thread first
+int TASK_Steal(TASK_Deque *deque, POLY_Polymorphic *value);
+
+// initialize a pool and start its threads
+// a pool of no threads is valid, its tasks are run by threads waiting on them
+// takes a pointer to the pool to initialize and the number of threads
+// returns a pointer to the pool
+TASK_Pool *TASK_Initialize(TASK_Pool *pool, unsigned int threads);
+
+// stop the threads of a pool and free memory, every group of the pool must have been waited on
+// takes a pointer to the pool
+void TASK_Clear(TASK_Pool *pool);
+
+// initialize a group of tasks
+// takes a pointer to the pool running the tasks and a pointer to the group to initialize
+// returns a pointer to the group
+TASK_Group *TASK_InitializeGroup(TASK_Pool *pool, TASK_Group *group);
+
+// spawn a task in a group, the task may be run by any thread of the pool or by a thread waiting on a group of the pool
+// takes a pointer to the group, the function to run and its argument
+void TASK_Spawn(TASK_Group *group, TASK_Function function, POLY_Polymorphic argument);
+
+// wait until every task spawned in a group has been run, running tasks of the pool while waiting
+// takes a pointer to the group
+void TASK_Wait(TASK_Group *group);
+
+// run a function over a range in parallel, splitting the range in halves until parts are no larger than the grain
+// returns once the function has been run over every part
+// takes a pointer to the pool, the start and exclusive end of the range, the grain, the function and its argument
+void TASK_ParallelFor(TASK_Pool *pool, unsigned long begin, unsigned long end, unsigned long grain, TASK_RangeFunction function, POLY_Polymorphic argument);
+
+#endif
@@ -0,0 +1,126 @@
+/*
+Test for B-tree set or tree map implementation
+
+Copyright (C) 2016 Kyle Gagner
+All Rights Reserved
+
+Fills a tree with owned string keys and values, freed by the tree, and deletes and replaces them in a reproducible
+pseudorandom order, checking the tree against a table of which keys it should hold after every operation
+prints the first failure and exits with status 1, or prints OK and exits with status 0
+run under AddressSanitizer so a key used after the tree frees it fails the test:
+gcc -std=gnu11 -g -fsanitize=address,undefined -o test_btree btree.c test_btree.c && ./test_btree
+usage: test_btree [keys] [operations] [seed]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "btree.h"
+
+// compares keys as strings
+int TextComparator(POLY_Polymorphic key1, POLY_Polymorphic key2)
+{
+	return strcmp(key1.ref, key2.ref);
+}
+
+// frees a key or value owned by the tree
+void FreeText(POLY_Polymorphic item)
+{
+	free(item.ref);
+}
+
+// makes an owned string for a number
+// takes the number and a prefix telling keys from values
+// returns the string
+char *Text(unsigned long number, char prefix)
+{
+	char *text = malloc(24);
+	sprintf(text, "%c%08lu", prefix, number);
+	return text;
+}
+
+// advances a pseudorandom generator
+// returns the next number
+unsigned long Random(unsigned long *seed)
+{
+	*seed = *seed*6364136223846793005UL + 1442695040888963407UL;
+	return *seed >> 33;
+}
+
+// checks that a tree holds exactly the keys marked present, in order, each with the value last set for it
+// returns 1 if it does, 0 otherwise
+int Check(BTREE_Tree *tree, unsigned long *versions, unsigned long keys)
+{
+	unsigned long size = 0;
+	for(unsigned long n = 0; n < keys; n++) if(versions[n]) size++;
+	if(BTREE_Size(tree) != size) return 0;
+	BTREE_Iterator iterator;
+	BTREE_InitializeIterator(tree, &iterator);
+	for(unsigned long n = 0; n < keys; n++)
+	{
+		if(!versions[n]) continue;
+		if(!BTREE_Next(&iterator)) return 0;
+		char expected[24];
+		sprintf(expected, "k%08lu", n);
+		if(strcmp(BTREE_Key(&iterator).ref, expected)) return 0;
+		sprintf(expected, "v%08lu", versions[n]);
+		if(strcmp(BTREE_Value(&iterator).ref, expected)) return 0;
+	}
+	return !BTREE_Next(&iterator);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long keys = argc > 1 ? strtoul(argv[1], NULL, 10) : 500;
+	unsigned long operations = argc > 2 ? strtoul(argv[2], NULL, 10) : 20000;
+	unsigned long seed = argc > 3 ? strtoul(argv[3], NULL, 10) : 1;
+	if(!keys) keys = 1;
+	// versions[n] is 0 if key n is absent, otherwise the number in its current value
+	unsigned long *versions = calloc(keys, sizeof(unsigned long));
+	BTREE_Tree tree;
+	BTREE_Initialize(&tree, FreeText, FreeText, TextComparator);
+	for(unsigned long n = 0; n < operations; n++)
+	{
+		unsigned long key = Random(&seed) % keys;
+		unsigned long choice = Random(&seed) % 3;
+		char *probe = Text(key, 'k');
+		if(choice < 2)
+		{
+			// setting a present key replaces its value and frees the new key, since the tree keeps the key it holds
+			unsigned long version = n + 1;
+			int present = versions[key] != 0;
+			BTREE_Set(&tree, POLY_REF(probe), POLY_REF(Text(version, 'v')));
+			if(present) free(probe);
+			versions[key] = version;
+		}
+		else
+		{
+			// the key deleted is the tree's own copy, the probe is only compared against
+			BTREE_Delete(&tree, POLY_REF(probe));
+			free(probe);
+			versions[key] = 0;
+		}
+		if(!Check(&tree, versions, keys))
+		{
+			printf("FAIL after operation %lu on key %lu\n", n, key);
+			return 1;
+		}
+	}
+	// deleting every key in turn empties the tree through every merge
+	for(unsigned long n = 0; n < keys; n++)
+	{
+		char *probe = Text(n, 'k');
+		BTREE_Delete(&tree, POLY_REF(probe));
+		free(probe);
+		versions[n] = 0;
+		if(!Check(&tree, versions, keys))
+		{
+			printf("FAIL deleting key %lu\n", n);
+			return 1;
+		}
+	}
+	BTREE_Clear(&tree);
+	free(versions);
+	printf("OK\n");
+	return 0;
+}
@@ -0,0 +1,166 @@
+/*
+Test for regular expression compiler
+
+Copyright (C) 2016 Kyle Gagner
+All Rights Reserved
+
+Compiles grammars holding assertions serially without groups and again with groups and threads, checking that every
+compilation makes a minimal machine of the same number of states, with the same start states shared between contexts,
+and that the machines find the same longest match at every position of sample texts
+prints the first failure and exits with status 1, or prints OK and exits with status 0
+gcc -std=gnu11 -g -fsanitize=address,undefined -o test_regex avl.c btree.c cmap.c cset.c deque.c hash.c list.c mem.c pavl.c queue.c regex.c task.c ulist.c unicode.c test_regex.c -lpthread -lm && ./test_regex
+usage: test_regex
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "regex.h"
+
+// a grammar, its expressions ending with NULL, and the texts its machines are run on ending with NULL
+// an expression ending in "(?i)" is case insensitive, the marker being removed
+typedef struct
+{
+	const char *name;
+	const char *expressions[12];
+	const char *texts[4];
+} Grammar;
+
+// the groups and threads each grammar is compiled with, the first being the compilation the others are checked against
+const unsigned int options[][2] = {{0, 0}, {0, 4}, {2, 0}, {3, 0}, {3, 3}, {4, 2}};
+
+// makes the expressions of a grammar, each accepting with its position plus one
+void Load(const Grammar *grammar, REGEX_Expressions *expressions)
+{
+	unsigned long count = 0;
+	while(grammar->expressions[count]) count++;
+	expressions->expressions_count = count;
+	expressions->expressions = calloc(count, sizeof(REGEX_Expression));
+	for(unsigned long n = 0; n < count; n++)
+	{
+		const char *text = grammar->expressions[n];
+		unsigned long length = strlen(text);
+		REGEX_Expression *expression = &expressions->expressions[n];
+		expression->flags = 0;
+		if(length >= 4 && !strcmp(text + length - 4, "(?i)"))
+		{
+			length -= 4;
+			expression->flags = REGEX_CASE_INSENSITIVE;
+		}
+		expression->expression = malloc(sizeof(UNICODE_Char)*(length + 1));
+		for(unsigned long i = 0; i < length; i++) expression->expression[i] = (unsigned char)text[i];
+		expression->expression[length] = 0;
+		expression->accepts = n + 1;
+	}
+}
+
+// frees the expressions of a grammar
+void Release(REGEX_Expressions *expressions)
+{
+	for(unsigned long n = 0; n < expressions->expressions_count; n++) free(expressions->expressions[n].expression);
+	free(expressions->expressions);
+}
+
+// finds the context of the character at a position of a text, REGEX_TEXT outside it
+int ContextAt(const char *text, long position)
+{
+	if(position < 0 || !text[position]) return REGEX_TEXT;
+	return REGEX_Context((unsigned char)text[position]);
+}
+
+// finds the longest match of a machine starting at a position of a text
+// takes the machine, the text, the position and where to put the end of the match
+// returns the value the match accepts with, 0 if there is none
+unsigned long Match(REGEX_Machine *machine, const char *text, long position, long *end)
+{
+	unsigned long state = machine->starts[ContextAt(text, position - 1)];
+	unsigned long accepts = REGEX_Accepts(&machine->states[state], ContextAt(text, position));
+	*end = position;
+	for(long n = position; text[n]; n++)
+	{
+		REGEX_State *current = &machine->states[state];
+		unsigned short t;
+		for(t = 0; t < current->transitions_count; t++) if(current->transitions[t].on == (unsigned char)text[n]) break;
+		if(t == current->transitions_count) break;
+		state = current->transitions[t].to;
+		unsigned long found = REGEX_Accepts(&machine->states[state], ContextAt(text, n + 1));
+		if(found)
+		{
+			accepts = found;
+			*end = n + 1;
+		}
+	}
+	return accepts;
+}
+
+// checks a machine compiled with groups or threads against the one compiled without
+// returns 1 if they agree, 0 otherwise, printing how they differ
+int Agree(const Grammar *grammar, REGEX_Machine *expected, REGEX_Machine *machine, const unsigned int *option)
+{
+	if(machine->states_count != expected->states_count)
+	{
+		printf("FAIL %s with %u groups and %u threads: %lu states, %lu without groups\n", grammar->name, option[0], option[1],
+			machine->states_count, expected->states_count);
+		return 0;
+	}
+	for(int i = 0; i < REGEX_CONTEXTS; i++) for(int j = 0; j < i; j++)
+	{
+		if((machine->starts[i] == machine->starts[j]) != (expected->starts[i] == expected->starts[j]))
+		{
+			printf("FAIL %s with %u groups and %u threads: the start states of contexts %d and %d are %s\n", grammar->name, option[0], option[1],
+				j, i, machine->starts[i] == machine->starts[j] ? "shared" : "distinct");
+			return 0;
+		}
+	}
+	for(int t = 0; grammar->texts[t]; t++)
+	{
+		const char *text = grammar->texts[t];
+		for(long position = 0; position <= (long)strlen(text); position++)
+		{
+			long end, expected_end;
+			unsigned long accepts = Match(machine, text, position, &end);
+			unsigned long expected_accepts = Match(expected, text, position, &expected_end);
+			if(accepts != expected_accepts || (accepts && end != expected_end))
+			{
+				printf("FAIL %s with %u groups and %u threads: at %ld of text %d matches %lu to %ld, %lu to %ld without groups\n", grammar->name,
+					option[0], option[1], position, t, accepts, end, expected_accepts, expected_end);
+				return 0;
+			}
+		}
+	}
+	return 1;
+}
+
+int main()
+{
+	const Grammar grammars[] =
+	{
+		{"lexer",
+			{"\\bif\\b", "\\belse\\b(?i)", "\\bwhile\\b", "(a|b|c|d|e|f|h|i|l|s|w)+", "(0|1|2|3)+\\b", "^#", "\n", " +", ";$", "\\Bs\\b", NULL},
+			{"if else while\n#x ifs\nwhile;", "elses 12 3a ;;\n", "IF Else;", NULL}},
+		{"anchored stars", {"(a|b)*^", "c", "\\Aa", "(a|b)*", NULL}, {"abcab", "cba", NULL}},
+		{"boundaries", {"\\B^", "^", "x?", " \\A(?i)", NULL}, {"x x\nx", " ", NULL}},
+		{"nested repetition", {"a(ab|c)+", " (ab|c)+(a|b)*(ab|c)+", "c", NULL}, {"acabc abab", " abcab", NULL}}
+	};
+	int failed = 0;
+	for(unsigned long g = 0; g < sizeof(grammars)/sizeof(Grammar); g++)
+	{
+		REGEX_Expressions expressions;
+		Load(&grammars[g], &expressions);
+		REGEX_Options compile = {options[0][0], options[0][1], NULL};
+		REGEX_Machine *expected = REGEX_CreateMachineWithOptions(&expressions, &compile);
+		for(unsigned long o = 1; o < sizeof(options)/sizeof(options[0]); o++)
+		{
+			compile.groups = options[o][0];
+			compile.threads = options[o][1];
+			REGEX_Machine *machine = REGEX_CreateMachineWithOptions(&expressions, &compile);
+			if(!Agree(&grammars[g], expected, machine, options[o])) failed = 1;
+			REGEX_DestroyMachine(machine);
+		}
+		REGEX_DestroyMachine(expected);
+		Release(&expressions);
+	}
+	if(failed) return 1;
+	printf("OK\n");
+	return 0;
+}
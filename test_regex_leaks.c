@@ -0,0 +1,104 @@
+/*
+Leak test for regular expression compiler
+
+Copyright (C) 2016 Kyle Gagner
+All Rights Reserved
+
+Compiles a lexer grammar with assertions and case insensitive expressions over and over, serially, with threads, with groups
+and with both, destroying each machine, so that memory left behind by any phase of any kind of compilation adds up
+built with MEM_ACCOUNTING, it checks that every subsystem has as many bytes live after each machine is destroyed as before it
+was compiled, and run under LeakSanitizer, any memory never freed fails the test when the program exits
+prints the first failure and exits with status 1, or prints OK and exits with status 0
+gcc -std=gnu11 -g -fsanitize=address,undefined -DMEM_ACCOUNTING -o test_regex_leaks avl.c btree.c cmap.c cset.c deque.c hash.c list.c mem.c pavl.c queue.c regex.c task.c ulist.c unicode.c test_regex_leaks.c -lpthread -lm && ./test_regex_leaks
+usage: test_regex_leaks [repetitions]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "regex.h"
+#include "avl.h"
+#include "mem.h"
+
+// the expressions of the grammar, an expression ending in "(?i)" is case insensitive, the marker being removed
+const char *grammar[] =
+{
+	"\\bif\\b",
+	"\\belse\\b",
+	"\\bwhile\\b(?i)",
+	"\\breturn\\b(?i)",
+	"(a|b|c|d|e|f|g|h|i|l|n|r|s|t|u|w|_)(a|b|c|d|e|f|g|h|i|l|n|r|s|t|u|w|_|0|1|2|3)*",
+	"(0|1|2|3|4|5|6|7|8|9)+\\b",
+	"0x(0|1|2|3|4|5|6|7|8|9|a|b|c|d|e|f)+(?i)",
+	"^#(a|b|c|d|e| )*$",
+	"\"(a|b|c| |\\\\\")*\"",
+	"\\A(a|b)*",
+	"(x|y)+\\z",
+	" +",
+	"\n",
+	"\\Bs\\b"
+};
+
+// the threads and groups the grammar is compiled with
+const unsigned int options[][2] = {{0, 0}, {4, 0}, {0, 3}, {3, 3}, {2, 5}};
+
+int main(int argc, char **argv)
+{
+	int repetitions = argc > 1 ? atoi(argv[1]) : 5;
+	REGEX_Expressions expressions;
+	expressions.expressions_count = sizeof(grammar)/sizeof(grammar[0]);
+	expressions.expressions = calloc(expressions.expressions_count, sizeof(REGEX_Expression));
+	for(unsigned long n = 0; n < expressions.expressions_count; n++)
+	{
+		unsigned long length = strlen(grammar[n]);
+		REGEX_Expression *expression = &expressions.expressions[n];
+		expression->flags = 0;
+		if(length >= 4 && !strcmp(grammar[n] + length - 4, "(?i)"))
+		{
+			length -= 4;
+			expression->flags = REGEX_CASE_INSENSITIVE;
+		}
+		expression->expression = malloc(sizeof(UNICODE_Char)*(length + 1));
+		for(unsigned long i = 0; i < length; i++) expression->expression[i] = (unsigned char)grammar[n][i];
+		expression->expression[length] = 0;
+		expression->accepts = n + 1;
+	}
+	int failed = 0;
+	unsigned long states_count = 0;
+	for(int r = 0; r < repetitions && !failed; r++)
+	{
+		for(unsigned long o = 0; o < sizeof(options)/sizeof(options[0]) && !failed; o++)
+		{
+			REGEX_Options compile = {options[o][0], options[o][1], NULL};
+			MEM_Snapshot before, after;
+			MEM_TakeSnapshot(&before);
+			REGEX_Machine *machine = REGEX_CreateMachineWithOptions(&expressions, &compile);
+			if(!machine || !machine->states_count || (states_count && machine->states_count != states_count))
+			{
+				printf("FAIL compiling with %u threads and %u groups in repetition %d\n", options[o][0], options[o][1], r);
+				failed = 1;
+			}
+			else states_count = machine->states_count;
+			if(machine) REGEX_DestroyMachine(machine);
+			// the nodes pooled by this thread are kept for reuse, not left behind
+			AVL_ReleasePool();
+			MEM_TakeSnapshot(&after);
+			for(int s = 0; s < MEM_SUBSYSTEMS && !failed; s++)
+			{
+				if(after.counts[s].live != before.counts[s].live)
+				{
+					printf("FAIL compiling with %u threads and %u groups in repetition %d left %ld bytes of %s\n", options[o][0], options[o][1], r,
+						(long)(after.counts[s].live - before.counts[s].live), MEM_Name(s));
+					failed = 1;
+				}
+			}
+		}
+	}
+	for(unsigned long n = 0; n < expressions.expressions_count; n++) free(expressions.expressions[n].expression);
+	free(expressions.expressions);
+	// LeakSanitizer ends the program without flushing output once it finds leaks
+	fflush(stdout);
+	if(failed) return 1;
+	printf("OK\n");
+	return 0;
+}
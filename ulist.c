@@ -0,0 +1,233 @@
+/*
+Source file for unrolled linked list implementation
+
+Copyright (C) 2016 Kyle Gagner
+All Rights Reserved
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "ulist.h"
+
+// value index of a node
+#define VALUE(node, index) ((node)->values[(node)->first + (index)])
+
+ULIST_List* ULIST_Initialize(ULIST_List* list)
+{
+	list->first = NULL;
+	list->last = NULL;
+	list->size = 0;
+	return list;
+}
+
+void ULIST_Clear(ULIST_List* list)
+{
+	ULIST_Node* node = list->first;
+	while(node)
+	{
+		ULIST_Node* next = node->next;
+		free(node);
+		node = next;
+	}
+	ULIST_Initialize(list);
+}
+
+// helper function allocates an empty node and links it between two other nodes or at either end of a list
+// takes a pointer to the list, pointers to the previous and next nodes, and where in the node its values will start
+// returns a pointer to the node
+ULIST_Node* ULIST_CreateNode(ULIST_List* list, ULIST_Node* prev, ULIST_Node* next, unsigned short first)
+{
+	ULIST_Node* node = malloc(sizeof(ULIST_Node));
+	node->first = first;
+	node->count = 0;
+	node->prev = prev;
+	node->next = next;
+	if(prev) prev->next = node;
+	else list->first = node;
+	if(next) next->prev = node;
+	else list->last = node;
+	return node;
+}
+
+// helper function unlinks and frees a node
+// takes a pointer to the list and the node
+void ULIST_DestroyNode(ULIST_List* list, ULIST_Node* node)
+{
+	if(node->prev) node->prev->next = node->next;
+	else list->first = node->next;
+	if(node->next) node->next->prev = node->prev;
+	else list->last = node->prev;
+	free(node);
+}
+
+void ULIST_InsertHead(ULIST_List* list, POLY_Polymorphic value)
+{
+	ULIST_Node* node = list->first;
+	// a new node at the head is filled from its end, so further insertions at the head need no moves
+	if(!node || !node->first) node = ULIST_CreateNode(list, NULL, node, ULIST_VALUES);
+	node->first--;
+	node->count++;
+	node->values[node->first] = value;
+	list->size++;
+}
+
+void ULIST_InsertTail(ULIST_List* list, POLY_Polymorphic value)
+{
+	ULIST_Node* node = list->last;
+	if(!node || node->first + node->count == ULIST_VALUES) node = ULIST_CreateNode(list, node, NULL, 0);
+	node->values[node->first + node->count++] = value;
+	list->size++;
+}
+
+POLY_Polymorphic ULIST_TakeHead(ULIST_List* list)
+{
+	ULIST_Node* node = list->first;
+	if(!node) return POLY_DEFAULT;
+	POLY_Polymorphic value = VALUE(node, 0);
+	node->first++;
+	if(!--node->count) ULIST_DestroyNode(list, node);
+	list->size--;
+	return value;
+}
+
+POLY_Polymorphic ULIST_TakeTail(ULIST_List* list)
+{
+	ULIST_Node* node = list->last;
+	if(!node) return POLY_DEFAULT;
+	POLY_Polymorphic value = VALUE(node, node->count - 1);
+	if(!--node->count) ULIST_DestroyNode(list, node);
+	list->size--;
+	return value;
+}
+
+POLY_Polymorphic ULIST_PeekHead(ULIST_List* list)
+{
+	if(!list->first) return POLY_DEFAULT;
+	return VALUE(list->first, 0);
+}
+
+POLY_Polymorphic ULIST_PeekTail(ULIST_List* list)
+{
+	if(!list->last) return POLY_DEFAULT;
+	return VALUE(list->last, list->last->count - 1);
+}
+
+unsigned long ULIST_Size(ULIST_List* list)
+{
+	return list->size;
+}
+
+ULIST_Iterator* ULIST_InitializeIterator(ULIST_List* list, ULIST_Iterator* iterator)
+{
+	iterator->list = list;
+	iterator->node = NULL;
+	iterator->index = 0;
+	return iterator;
+}
+
+int ULIST_Next(ULIST_Iterator* iterator)
+{
+	if(!iterator->node)
+	{
+		iterator->node = iterator->list->first;
+		if(iterator->node) iterator->index = iterator->node->first;
+	}
+	else if(++iterator->index == iterator->node->first + iterator->node->count)
+	{
+		iterator->node = iterator->node->next;
+		if(iterator->node) iterator->index = iterator->node->first;
+	}
+	if(iterator->node) return 1;
+	else return 0;
+}
+
+POLY_Polymorphic ULIST_Peek(ULIST_Iterator* iterator)
+{
+	if(iterator->node) return iterator->node->values[iterator->index];
+	else return POLY_DEFAULT;
+}
+
+void ULIST_Reset(ULIST_Iterator* iterator)
+{
+	iterator->node = NULL;
+	iterator->index = 0;
+}
+
+void ULIST_InsertAfter(ULIST_Iterator* iterator, POLY_Polymorphic value)
+{
+	ULIST_List* list = iterator->list;
+	ULIST_Node* node = iterator->node;
+	unsigned short index;
+	if(!node)
+	{
+		ULIST_InsertHead(list, value);
+		iterator->node = list->first;
+		iterator->index = list->first->first;
+		return;
+	}
+	index = iterator->index - node->first + 1;
+	if(node->count == ULIST_VALUES)
+	{
+		// a full node is split in half, and the value goes in whichever half holds its place
+		ULIST_Node* split = ULIST_CreateNode(list, node, node->next, 0);
+		split->count = node->count/2;
+		node->count -= split->count;
+		memcpy(split->values, &VALUE(node, node->count), sizeof(POLY_Polymorphic)*split->count);
+		if(index > node->count)
+		{
+			index -= node->count;
+			node = split;
+		}
+	}
+	if(node->first + node->count == ULIST_VALUES)
+	{
+		memmove(node->values, &VALUE(node, 0), sizeof(POLY_Polymorphic)*node->count);
+		node->first = 0;
+	}
+	memmove(&VALUE(node, index + 1), &VALUE(node, index), sizeof(POLY_Polymorphic)*(node->count - index));
+	VALUE(node, index) = value;
+	node->count++;
+	list->size++;
+	iterator->node = node;
+	iterator->index = node->first + index;
+}
+
+POLY_Polymorphic ULIST_Remove(ULIST_Iterator* iterator)
+{
+	ULIST_List* list = iterator->list;
+	ULIST_Node* node = iterator->node;
+	if(!node) return POLY_DEFAULT;
+	unsigned short index = iterator->index - node->first;
+	POLY_Polymorphic value = VALUE(node, index);
+	memmove(&VALUE(node, index), &VALUE(node, index + 1), sizeof(POLY_Polymorphic)*(node->count - index - 1));
+	node->count--;
+	list->size--;
+	if(index)
+	{
+		iterator->index--;
+	}
+	else
+	{
+		iterator->node = node->prev;
+		iterator->index = node->prev ? node->prev->first + node->prev->count - 1 : 0;
+	}
+	if(!node->count)
+	{
+		ULIST_DestroyNode(list, node);
+	}
+	else if(node->next && node->count + node->next->count <= ULIST_VALUES/2)
+	{
+		// sparse neighbours are merged into the first of them, which keeps the position of the iterator valid
+		ULIST_Node* next = node->next;
+		if(node->first + node->count + next->count > ULIST_VALUES)
+		{
+			if(iterator->node == node) iterator->index -= node->first;
+			memmove(node->values, &VALUE(node, 0), sizeof(POLY_Polymorphic)*node->count);
+			node->first = 0;
+		}
+		memcpy(&VALUE(node, node->count), &VALUE(next, 0), sizeof(POLY_Polymorphic)*next->count);
+		node->count += next->count;
+		ULIST_DestroyNode(list, next);
+	}
+	return value;
+}
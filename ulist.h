@@ -0,0 +1,125 @@
+/*
+Header file for unrolled linked list implementation
+
+Copyright (C) 2016 Kyle Gagner
+All Rights Reserved
+*/
+
+#include "poly.h"
+
+// include guard
+#ifndef ULIST_H
+#define ULIST_H
+
+// a definition for NULL may be needed
+#ifndef NULL
+#define NULL ((void*)0)
+#endif
+
+// number of values held by a node, so that a node fills two cache lines
+#define ULIST_VALUES 13
+
+// represents a node in an unrolled linked list, holding up to ULIST_VALUES values
+// the values of the node are values[first] through values[first + count - 1], and no node in a list is empty
+typedef struct ULIST_Node
+{
+	struct ULIST_Node* prev;
+	struct ULIST_Node* next;
+	unsigned short first;
+	unsigned short count;
+	POLY_Polymorphic values[ULIST_VALUES];
+} ULIST_Node;
+
+// represents an unrolled linked list
+typedef struct ULIST_List
+{
+	ULIST_Node* first;
+	ULIST_Node* last;
+	unsigned long size;
+} ULIST_List;
+
+// represents an iterator for an unrolled list
+// the current value is values[index] of node, and node is NULL when the iterator is reset
+// insertions and removals at the ends of the list leave the iterator in place unless they remove its current value
+typedef struct ULIST_Iterator
+{
+	ULIST_List* list;
+	ULIST_Node* node;
+	unsigned short index;
+} ULIST_Iterator;
+
+// initialize a list
+// takes a pointer to the list to initialize
+// returns a pointer to the list
+ULIST_List* ULIST_Initialize(ULIST_List* list);
+
+// remove all items from a list and free memory
+// takes a pointer to the list
+void ULIST_Clear(ULIST_List* list);
+
+// insert at the head of a list
+// takes a pointer to the list and the value to insert
+void ULIST_InsertHead(ULIST_List* list, POLY_Polymorphic value);
+
+// insert at the tail of a list
+// takes a pointer to the list and the value to insert
+void ULIST_InsertTail(ULIST_List* list, POLY_Polymorphic value);
+
+// take a value from the head of a list
+// takes a pointer to the list
+// returns the value removed
+POLY_Polymorphic ULIST_TakeHead(ULIST_List* list);
+
+// take a value from the tail of a list
+// takes a pointer to the list
+// returns the value removed
+POLY_Polymorphic ULIST_TakeTail(ULIST_List* list);
+
+// get a value from the head of a list without removing it
+// takes a pointer to the list
+// returns the value
+POLY_Polymorphic ULIST_PeekHead(ULIST_List* list);
+
+// get a value from the tail of a list without removing it
+// takes a pointer to the list
+// returns the value
+POLY_Polymorphic ULIST_PeekTail(ULIST_List* list);
+
+// finds the size of a list
+// takes a pointer to the list
+// returns the number of elements in the list
+unsigned long ULIST_Size(ULIST_List* list);
+
+// initialize an iterator for a list
+// takes a pointer to the list upon which to iterate and a pointer to the iterator to initialize
+// returns a pointer to the iterator
+ULIST_Iterator* ULIST_InitializeIterator(ULIST_List* list, ULIST_Iterator* iterator);
+
+// gets the next element from an iterator
+// takes a pointer to the iterator
+// returns 0 if the end has been reached, 1 otherwise
+int ULIST_Next(ULIST_Iterator* iterator);
+
+// gets the current element from an iterator
+// takes a pointer to the iterator
+// returns the value
+POLY_Polymorphic ULIST_Peek(ULIST_Iterator* iterator);
+
+// resets an iterator to the beginning
+// takes a pointer to the iterator
+void ULIST_Reset(ULIST_Iterator* iterator);
+
+// insert after the current element of an iterator, or at the head of the list if the iterator is reset
+// other iterators of the list are invalidated
+// takes a pointer to the iterator and the value to insert
+// the iterator moves to the value inserted
+void ULIST_InsertAfter(ULIST_Iterator* iterator, POLY_Polymorphic value);
+
+// remove the current element of an iterator
+// other iterators of the list are invalidated
+// takes a pointer to the iterator
+// the iterator moves to the element before, or is reset if there is none, so the next element is the one after the one removed
+// returns the value removed
+POLY_Polymorphic ULIST_Remove(ULIST_Iterator* iterator);
+
+#endif
@@ -24,4 +24,11 @@ typedef unsigned short UNICODE_Char;
 // returns result of comparison
 int UNICODE_CharComparator(POLY_Polymorphic key1, POLY_Polymorphic key2);
 
+// finds the next character in the simple case fold orbit of a character, the characters which simple case folding maps
+// to the same character, in increasing order and wrapping around, so calling it repeatedly from a character visits every
+// character equal to it ignoring case and then returns to it, characters outside the Basic Multilingual Plane are not folded
+// takes the character
+// returns the next character of its orbit, the character itself if it has no other case
+UNICODE_Char UNICODE_SimpleFold(UNICODE_Char c);
+
 #endif